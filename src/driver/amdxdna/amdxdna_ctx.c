@@ -17,6 +17,7 @@
 
 #define MAX_CTX_ID		255
 #define MAX_ARG_COUNT		4095
+#define MAX_CMD_COUNT		256
 
 struct amdxdna_fence {
 	struct dma_fence	base;
@@ -559,8 +560,11 @@ static int amdxdna_drm_submit_execbuf(struct amdxdna_client *client,
 				      struct amdxdna_drm_exec_cmd *args)
 {
 	struct amdxdna_dev *xdna = client->xdna;
-	u32 *arg_bo_hdls;
+	u32 cmd_count = args->cmd_count;
+	u32 *arg_bo_hdls = NULL;
+	u32 *cmd_bo_hdls;
 	u32 cmd_bo_hdl;
+	u32 i;
 	int ret;
 
 	if (args->arg_count > MAX_ARG_COUNT) {
@@ -568,39 +572,70 @@ static int amdxdna_drm_submit_execbuf(struct amdxdna_client *client,
 		return -EINVAL;
 	}
 
-	/* Only support single command for now. */
-	if (args->cmd_count != 1) {
-		XDNA_ERR(xdna, "Invalid cmd bo count %d", args->cmd_count);
+	if (!cmd_count || cmd_count > MAX_CMD_COUNT) {
+		XDNA_ERR(xdna, "Invalid cmd bo count %d", cmd_count);
 		return -EINVAL;
 	}
 
-	cmd_bo_hdl = (u32)args->cmd_handles;
-	if (cmd_bo_hdl == AMDXDNA_INVALID_BO_HANDLE) {
-		XDNA_ERR(xdna, "Invalid cmd bo handle");
-		return -EINVAL;
+	/*
+	 * Single command passes the handle itself, multiple commands pass
+	 * an array of handles. All commands share the same arg bo list.
+	 */
+	if (cmd_count == 1) {
+		cmd_bo_hdl = (u32)args->cmd_handles;
+		cmd_bo_hdls = &cmd_bo_hdl;
+	} else {
+		cmd_bo_hdls = kcalloc(cmd_count, sizeof(u32), GFP_KERNEL);
+		if (!cmd_bo_hdls)
+			return -ENOMEM;
+		if (copy_from_user(cmd_bo_hdls, u64_to_user_ptr(args->cmd_handles),
+				   cmd_count * sizeof(u32))) {
+			ret = -EFAULT;
+			goto free_bo_hdls;
+		}
 	}
 
-	if (!args->arg_count) {
-		arg_bo_hdls = NULL;
-	} else {
+	for (i = 0; i < cmd_count; i++) {
+		if (cmd_bo_hdls[i] == AMDXDNA_INVALID_BO_HANDLE) {
+			XDNA_ERR(xdna, "Invalid cmd bo handle at %d", i);
+			ret = -EINVAL;
+			goto free_bo_hdls;
+		}
+	}
+
+	if (args->arg_count) {
 		arg_bo_hdls = kcalloc(args->arg_count, sizeof(u32), GFP_KERNEL);
-		if (!arg_bo_hdls)
-			return -ENOMEM;
+		if (!arg_bo_hdls) {
+			ret = -ENOMEM;
+			goto free_bo_hdls;
+		}
 		ret = copy_from_user(arg_bo_hdls, u64_to_user_ptr(args->args),
 				     args->arg_count * sizeof(u32));
 		if (ret) {
 			ret = -EFAULT;
-			goto free_cmd_bo_hdls;
+			goto free_bo_hdls;
 		}
 	}
 
-	ret = amdxdna_cmd_submit(client, OP_USER, cmd_bo_hdl, arg_bo_hdls,
-				 args->arg_count, NULL, NULL, 0, args->hwctx, &args->seq);
+	/*
+	 * Commands are pushed one by one in array order. On failure, tell
+	 * user how many commands went through and the seq of the last one,
+	 * so that they can still be waited on.
+	 */
+	for (i = 0; i < cmd_count; i++) {
+		ret = amdxdna_cmd_submit(client, OP_USER, cmd_bo_hdls[i], arg_bo_hdls,
+					 args->arg_count, NULL, NULL, 0, args->hwctx,
+					 &args->seq);
+		if (ret)
+			break;
+		XDNA_DBG(xdna, "Pushed job %lld to scheduler", args->seq);
+	}
+	args->cmd_count = i;
 
-free_cmd_bo_hdls:
+free_bo_hdls:
 	kfree(arg_bo_hdls);
-	if (!ret)
-		XDNA_DBG(xdna, "Pushed job %lld to scheduler", args->seq);
+	if (cmd_bo_hdls != &cmd_bo_hdl)
+		kfree(cmd_bo_hdls);
 	return ret;
 }
 
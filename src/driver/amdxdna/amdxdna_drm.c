@@ -159,6 +159,22 @@ static int amdxdna_drm_gem_mmap(struct file *filp, struct vm_area_struct *vma)
 	return xdna->dev_info->ops->mmap(xdna, vma);
 }
 
+/* Features of the common driver code, same for all devices. */
+static int amdxdna_query_features(struct amdxdna_client *client,
+				  struct amdxdna_drm_get_info *args)
+{
+	struct amdxdna_drm_query_features features = {};
+	int min;
+
+	features.flags = AMDXDNA_FEATURE_EXEC_CMD_BATCH;
+
+	min = min(args->buffer_size, sizeof(features));
+	if (copy_to_user(u64_to_user_ptr(args->buffer), &features, min))
+		return -EFAULT;
+
+	return 0;
+}
+
 static int amdxdna_drm_get_info_ioctl(struct drm_device *dev, void *data, struct drm_file *filp)
 {
 	struct amdxdna_client *client = filp->driver_priv;
@@ -173,7 +189,10 @@ static int amdxdna_drm_get_info_ioctl(struct drm_device *dev, void *data, struct
 		return -ENODEV;
 
 	XDNA_DBG(xdna, "Request parameter %u", args->param);
-	ret = xdna->dev_info->ops->get_aie_info(client, args);
+	if (args->param == DRM_AMDXDNA_QUERY_FEATURES)
+		ret = amdxdna_query_features(client, args);
+	else
+		ret = xdna->dev_info->ops->get_aie_info(client, args);
 
 	drm_dev_exit(idx);
 	return ret;
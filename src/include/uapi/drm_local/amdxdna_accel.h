@@ -319,8 +319,10 @@ struct amdxdna_drm_sync_bo {
  *               in case of just one.
  * @args: Array of arguments for all command handles.
  * @cmd_count: Number of command handles in the cmd_handles array.
+ *             On return, number of commands actually submitted.
  * @arg_count: Number of arguments in the args array.
- * @seq: Returned sequence number for this command.
+ * @seq: Returned sequence number for this command. With multiple commands,
+ *       sequence number of the last submitted one.
  */
 struct amdxdna_drm_exec_cmd {
 	__u64 ext;
@@ -568,6 +570,17 @@ struct amdxdna_drm_get_resource_info {
 	__u64 npu_task_curr;
 };
 
+/**
+ * struct amdxdna_drm_query_features - Optional driver features
+ * @flags: AMDXDNA_FEATURE_* bits of features supported by the driver.
+ *
+ * Driver without DRM_AMDXDNA_QUERY_FEATURES supports none of them.
+ */
+struct amdxdna_drm_query_features {
+#define AMDXDNA_FEATURE_EXEC_CMD_BATCH	(1ULL << 0) /* cmd_count > 1 in exec_cmd */
+	__u64 flags; /* out */
+};
+
 /**
  * struct amdxdna_drm_attribute_state - Represent buffer packing for the below
  *					struct amdxdna_drm_<get/set>_state attributes,
@@ -627,6 +640,7 @@ struct amdxdna_drm_get_info {
 #define	DRM_AMDXDNA_GET_FRAME_BOUNDARY_PREEMPT_STATE	13
 #define	DRM_AMDXDNA_QUERY_CERT_FIRMWARE_VERSION		14
 #define	DRM_AMDXDNA_GET_AUTO_COREDUMP			15
+#define	DRM_AMDXDNA_QUERY_FEATURES			16
 	__u32 param; /* in */
 	__u32 buffer_size; /* in/out */
 	__u64 buffer; /* in/out */
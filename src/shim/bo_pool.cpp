@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2026, Advanced Micro Devices, Inc. All rights reserved.
+
+#include "bo_pool.h"
+#include "buffer.h"
+#include "shim_debug.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <unistd.h>
+
+namespace {
+
+const size_t page_size = sysconf(_SC_PAGESIZE);
+const size_t cacheline_size = 64;
+
+size_t
+next_power_of_two(size_t x)
+{
+  size_t p = 1;
+  while (p < x)
+    p <<= 1;
+  return p;
+}
+
+}
+
+namespace shim_xdna {
+
+bo_pool::
+bo_pool(size_t max_bytes, size_t max_bo_size)
+  : m_max_bytes(max_bytes)
+  , m_max_bo_size(max_bo_size)
+{
+  shim_debug("Created BO pool: max %zu bytes, max BO size %zu", m_max_bytes, m_max_bo_size);
+}
+
+bo_pool::
+~bo_pool()
+{
+  shutdown();
+}
+
+size_t
+bo_pool::
+size_class(size_t size) const
+{
+  if (!size || size > m_max_bo_size)
+    return 0;
+  return std::max(next_power_of_two(size), page_size);
+}
+
+std::unique_ptr<drm_bo>
+bo_pool::
+get(int type, size_t size)
+{
+  std::lock_guard<std::mutex> lg(m_lock);
+  auto it = m_free.find({ type, size_class(size) });
+  if (it == m_free.end()) {
+    m_stats.m_misses++;
+    return nullptr;
+  }
+
+  auto& bos = it->second;
+  auto found = std::find_if(bos.rbegin(), bos.rend(),
+    [size](const std::unique_ptr<drm_bo>& bo) { return bo->m_size >= size; });
+  if (found == bos.rend()) {
+    m_stats.m_misses++;
+    return nullptr;
+  }
+
+  auto bo = std::move(*found);
+  bos.erase(std::next(found).base());
+  m_stats.m_hits++;
+  m_stats.m_cached_bos--;
+  m_stats.m_cached_bytes -= bo->m_size;
+  return bo;
+}
+
+void
+bo_pool::
+put(int type, std::unique_ptr<drm_bo> bo)
+{
+  {
+    std::lock_guard<std::mutex> lg(m_lock);
+    if (!m_shutdown && bo->m_size <= m_max_bytes - std::min(m_max_bytes, m_stats.m_cached_bytes)) {
+      m_stats.m_recycled++;
+      m_stats.m_cached_bos++;
+      m_stats.m_cached_bytes += bo->m_size;
+      m_free[{ type, size_class(bo->m_size) }].push_back(std::move(bo));
+      return;
+    }
+    m_stats.m_dropped++;
+  }
+  // Free it outside of the lock.
+  bo.reset();
+}
+
+void
+bo_pool::
+trim(size_t target_bytes)
+{
+  std::vector< std::unique_ptr<drm_bo> > freed;
+  {
+    std::lock_guard<std::mutex> lg(m_lock);
+    for (auto it = m_free.rbegin(); it != m_free.rend(); ++it) {
+      auto& bos = it->second;
+      while (!bos.empty() && m_stats.m_cached_bytes > target_bytes) {
+        m_stats.m_cached_bytes -= bos.back()->m_size;
+        m_stats.m_cached_bos--;
+        m_stats.m_trimmed++;
+        freed.push_back(std::move(bos.back()));
+        bos.pop_back();
+      }
+    }
+  }
+  if (!freed.empty())
+    shim_debug("Trimmed %zu BOs from BO pool", freed.size());
+}
+
+void
+bo_pool::
+shutdown()
+{
+  {
+    std::lock_guard<std::mutex> lg(m_lock);
+    m_shutdown = true;
+  }
+  trim(0);
+}
+
+bo_pool::stats
+bo_pool::
+get_stats() const
+{
+  std::lock_guard<std::mutex> lg(m_lock);
+  return m_stats;
+}
+
+//
+// Impl for class bo_slab
+//
+
+bo_slab::
+bo_slab(std::unique_ptr<drm_bo> bo, size_t chunk_size)
+  : m_bo(std::move(bo))
+  , m_chunk_size(chunk_size)
+{
+  auto n = m_bo->m_size / m_chunk_size;
+  m_free.reserve(n);
+  // Hand out low offsets first.
+  for (size_t i = n; i > 0; i--)
+    m_free.push_back((i - 1) * m_chunk_size);
+}
+
+bo_slab::
+~bo_slab()
+{
+  shim_debug("Destroying slab BO %d", m_bo->m_id.handle);
+}
+
+const drm_bo&
+bo_slab::
+get_bo() const
+{
+  return *m_bo;
+}
+
+//
+// Impl for class slab_allocator
+//
+
+slab_allocator::
+slab_allocator(const pdev& dev, int type, size_t slab_size, size_t max_chunk_size)
+  : m_pdev(dev)
+  , m_type(type)
+  // Power of two slab holds a whole number of chunks of any size up to it.
+  , m_slab_size(std::max(next_power_of_two(slab_size), page_size))
+  , m_max_chunk_size(std::min(max_chunk_size, m_slab_size))
+{
+  shim_debug("Created slab allocator: slab size %zu, max chunk size %zu",
+    m_slab_size, m_max_chunk_size);
+}
+
+slab_allocator::
+~slab_allocator()
+{
+  shutdown();
+}
+
+size_t
+slab_allocator::
+chunk_size(size_t size) const
+{
+  if (!size || size > m_max_chunk_size)
+    return 0;
+  // CPU and device should not share cacheline.
+  return std::max(next_power_of_two(size), cacheline_size);
+}
+
+slab_allocator::chunk
+slab_allocator::
+alloc(size_t size)
+{
+  auto csz = chunk_size(size);
+  if (!csz)
+    shim_err(EINVAL, "Can't sub-allocate BO of size %zu", size);
+
+  std::lock_guard<std::mutex> lg(m_lock);
+  if (m_shutdown)
+    shim_err(EINVAL, "Slab allocator is shut down");
+
+  auto& slabs = m_slabs[csz];
+  for (auto& slab : slabs) {
+    if (slab->m_free.empty())
+      continue;
+    chunk c = { slab, slab->m_free.back() };
+    slab->m_free.pop_back();
+    // Chunk is reused, don't leak previous user's data.
+    std::memset(static_cast<char *>(slab->m_bo->m_vaddr->get()) + c.m_offset, 0, csz);
+    return c;
+  }
+
+  auto bo = std::make_unique<drm_bo>(m_pdev, m_slab_size, m_type);
+  bo->m_vaddr = std::make_unique<mmap_ptr>(&m_pdev, nullptr, bo->m_map_offset, m_slab_size);
+  shim_debug("Created slab BO %d for %zu bytes chunks", bo->m_id.handle, csz);
+  auto slab = std::make_shared<bo_slab>(std::move(bo), csz);
+  slabs.push_back(slab);
+  chunk c = { slab, slab->m_free.back() };
+  slab->m_free.pop_back();
+  return c;
+}
+
+void
+slab_allocator::
+free(const chunk& c)
+{
+  std::shared_ptr<bo_slab> released;
+  {
+    std::lock_guard<std::mutex> lg(m_lock);
+    if (m_shutdown)
+      return;
+
+    auto& slab = c.m_slab;
+    slab->m_free.push_back(c.m_offset);
+    if (slab->m_free.size() != slab->get_bo().m_size / slab->chunk_size())
+      return;
+
+    // Keep one empty slab per chunk size around to avoid thrashing.
+    auto& slabs = m_slabs[slab->chunk_size()];
+    auto empty = std::count_if(slabs.begin(), slabs.end(), [](const auto& s) {
+      return s->m_free.size() == s->get_bo().m_size / s->chunk_size(); });
+    if (empty <= 1)
+      return;
+    auto it = std::find(slabs.begin(), slabs.end(), slab);
+    released = std::move(*it);
+    slabs.erase(it);
+  }
+  // Slab BO is freed outside of the lock when last chunk user is gone.
+}
+
+void
+slab_allocator::
+shutdown()
+{
+  std::map< size_t, std::vector< std::shared_ptr<bo_slab> > > slabs;
+  {
+    std::lock_guard<std::mutex> lg(m_lock);
+    m_shutdown = true;
+    slabs.swap(m_slabs);
+  }
+}
+
+}
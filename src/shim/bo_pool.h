@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2026, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef BO_POOL_XDNA_H
+#define BO_POOL_XDNA_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace shim_xdna {
+
+class drm_bo;
+class pdev;
+
+// Cache of freed DRM BOs which are still mapped, grouped by BO type and size
+// class, so that next allocation of the same kind skips create/mmap ioctls.
+// Cache is bounded by total size of cached BOs. BOs keep their own size, size
+// class is only used to find a cached BO which is big enough.
+class bo_pool
+{
+public:
+  struct stats {
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_recycled = 0;
+    // Returned BOs which are freed since pool is full.
+    uint64_t m_dropped = 0;
+    uint64_t m_trimmed = 0;
+    size_t m_cached_bos = 0;
+    size_t m_cached_bytes = 0;
+  };
+
+  bo_pool(size_t max_bytes, size_t max_bo_size);
+  ~bo_pool();
+
+  // Size class of BO of size bytes, or 0 if it should not be pooled.
+  size_t
+  size_class(size_t size) const;
+
+  // Cached BO of the type no smaller than size, nullptr if there is none.
+  std::unique_ptr<drm_bo>
+  get(int type, size_t size);
+
+  // Hand a BO back. It is freed right away if pool is full or shut down.
+  void
+  put(int type, std::unique_ptr<drm_bo> bo);
+
+  // Free cached BOs, larger size classes first, till cached size is no more than target.
+  void
+  trim(size_t target_bytes);
+
+  // Free all cached BOs and stop caching, called before device is closed.
+  void
+  shutdown();
+
+  stats
+  get_stats() const;
+
+private:
+  using key = std::pair<int, size_t>; // BO type, size class
+
+  const size_t m_max_bytes;
+  const size_t m_max_bo_size;
+
+  mutable std::mutex m_lock;
+  std::map< key, std::vector< std::unique_ptr<drm_bo> > > m_free;
+  bool m_shutdown = false;
+  stats m_stats;
+};
+
+// One DRM BO carved into equal sized chunks for small BOs.
+class bo_slab
+{
+public:
+  bo_slab(std::unique_ptr<drm_bo> bo, size_t chunk_size);
+  ~bo_slab();
+
+  const drm_bo&
+  get_bo() const;
+
+  size_t
+  chunk_size() const
+  { return m_chunk_size; }
+
+private:
+  friend class slab_allocator;
+
+  std::unique_ptr<drm_bo> m_bo;
+  const size_t m_chunk_size;
+  // Offsets of free chunks, protected by allocator's lock.
+  std::vector<size_t> m_free;
+};
+
+// Sub-allocates small BOs of one type out of slabs, one set of slabs per
+// power-of-two chunk size. All BOs in a slab share its DRM BO handle.
+class slab_allocator
+{
+public:
+  struct chunk {
+    std::shared_ptr<bo_slab> m_slab;
+    size_t m_offset = 0;
+  };
+
+  // slab_size is rounded up to a power of two, no less than a page.
+  slab_allocator(const pdev& dev, int type, size_t slab_size, size_t max_chunk_size);
+  ~slab_allocator();
+
+  // Chunk size used for size bytes, or 0 if it should not be sub-allocated.
+  size_t
+  chunk_size(size_t size) const;
+
+  chunk
+  alloc(size_t size);
+
+  void
+  free(const chunk& c);
+
+  // Drop all free slabs and stop handing out chunks. Slabs still in use are
+  // freed by their last user.
+  void
+  shutdown();
+
+private:
+  const pdev& m_pdev;
+  const int m_type;
+  const size_t m_slab_size;
+  const size_t m_max_chunk_size;
+
+  std::mutex m_lock;
+  // Chunk size -> slabs
+  std::map< size_t, std::vector< std::shared_ptr<bo_slab> > > m_slabs;
+  bool m_shutdown = false;
+};
+
+}
+
+#endif
@@ -4,14 +4,18 @@
 // Disable debug print in this file.
 //#undef XDNA_SHIM_DEBUG
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <iostream>
+#include <sys/mman.h>
 
 #include "buffer.h"
 #include "shim_debug.h"
 #include "core/common/config_reader.h"
 #if defined(__x86_64__) || defined(_M_X64)
 #include <x86intrin.h>
+#include <cpuid.h>
 #endif
 
 namespace {
@@ -34,7 +38,26 @@ use_to_fw_debug_type(uint8_t use)
 }
 
 const uint64_t page_size = sysconf(_SC_PAGESIZE);
-const long cacheline_size = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+
+// Only BOs allocated by application can be recycled. Debug BOs are attached
+// to hwctx in driver and internal BOs are not allocated often.
+bool
+is_poolable(int type, uint64_t flags)
+{
+  if (!flags || (type != AMDXDNA_BO_SHARE && type != AMDXDNA_BO_CMD))
+    return false;
+
+  switch (xcl_bo_flags{flags}.use) {
+  case XRT_BO_USE_DEBUG:
+  case XRT_BO_USE_DTRACE:
+  case XRT_BO_USE_LOG:
+  case XRT_BO_USE_DEBUG_QUEUE:
+  case XRT_BO_USE_UC_DEBUG:
+    return false;
+  default:
+    return true;
+  }
+}
 
 bool
 is_power_of_two(size_t x)
@@ -126,41 +149,152 @@ to_hex_string(uint64_t num) {
   return ss.str();
 }
  
-inline void flush_cache_line(const char *cur)
-{
+// CPU cache maintenance for non coherent memory.
+// Picks the cheapest instruction the CPU has for the sync direction:
+// to device only needs dirty lines written back, from device needs lines
+// invalidated so that CPU reads what device wrote.
+class cache_engine
+{
+public:
+  cache_engine()
+  {
+    auto line = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    m_line_size = line > 0 ? line : 64;
+#if defined(__x86_64__) || defined(_M_X64)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+      m_has_clflushopt = ebx & bit_CLFLUSHOPT;
+      m_has_clwb = ebx & bit_CLWB;
+    }
+#endif
+    shim_debug("Cache line %ld, clflushopt %d, clwb %d",
+      m_line_size, m_has_clflushopt, m_has_clwb);
+  }
+
+  // All ranges are done in one go with a single fence on each end.
+  void
+  sync(const char *base, const std::vector<std::pair<size_t, size_t>>& ranges,
+    bool to_device) const
+  {
+    fence();
+    for (auto& [offset, len] : ranges) {
+      if (!len)
+        continue;
+      auto cur = reinterpret_cast<uintptr_t>(base + offset) & ~(m_line_size - 1);
+      auto end = reinterpret_cast<uintptr_t>(base + offset + len);
+      if (to_device)
+        writeback(cur, end);
+      else
+        invalidate(cur, end);
+    }
+    fence();
+  }
+
+private:
+  uintptr_t m_line_size;
+  bool m_has_clflushopt = false;
+  bool m_has_clwb = false;
+
+  static void
+  fence()
+  {
 #if defined(__x86_64__) || defined(_M_X64)
-  _mm_clflush(cur);
+    // x86 CLFLUSH* are not ordered vs younger loads; fence so the flush is globally
+    // observed before the host reads the line back (cf. kernel clflush_cache_range).
+    _mm_mfence();
 #elif defined(__aarch64__)
-  asm volatile(
-    "DC CIVAC, %[addr]\n"  // Clean and invalidate data cache
-    "DSB SY\n"             // Data Synchronization Barrier
-    "ISB SY\n"             // Instruction Synchronization Barrier
-    :
-    : [addr] "r" (cur)
-    : "memory"
-  );
+    asm volatile("DSB SY\n" "ISB SY\n" ::: "memory");
 #endif
-}
+  }
 
-// flash cache line for non coherent memory
-inline void
-clflush_data(const void *base, size_t offset, size_t len)
-{
-  const char *cur = (const char *)base;
-  cur += offset;
-  uintptr_t lastline = (uintptr_t)(cur + len - 1) | (cacheline_size - 1);
+  void
+  writeback(uintptr_t cur, uintptr_t end) const
+  {
 #if defined(__x86_64__) || defined(_M_X64)
-  // x86 CLFLUSH is not ordered vs younger loads; fence so the flush is globally
-  // observed before the host reads the line back (cf. kernel clflush_cache_range).
-  _mm_mfence();
+    if (m_has_clwb) {
+      // Line stays valid in cache, no refetch if CPU touches it again.
+      for (; cur < end; cur += m_line_size)
+        asm volatile("clwb %0" : "+m" (*reinterpret_cast<volatile char *>(cur)));
+      return;
+    }
+#elif defined(__aarch64__)
+    for (; cur < end; cur += m_line_size)
+      asm volatile("DC CVAC, %[addr]" : : [addr] "r" (cur) : "memory");
+    return;
 #endif
-  do {
-    flush_cache_line(cur);
-    cur += cacheline_size;
-  } while (cur <= (const char *)lastline);
+    invalidate(cur, end);
+  }
+
+  void
+  invalidate(uintptr_t cur, uintptr_t end) const
+  {
 #if defined(__x86_64__) || defined(_M_X64)
-  _mm_mfence();
+    if (m_has_clflushopt) {
+      // Unlike clflush, clflushopt to different lines are not serialized.
+      for (; cur < end; cur += m_line_size)
+        asm volatile("clflushopt %0" : "+m" (*reinterpret_cast<volatile char *>(cur)));
+    } else {
+      for (; cur < end; cur += m_line_size)
+        _mm_clflush(reinterpret_cast<const void *>(cur));
+    }
+#elif defined(__aarch64__)
+    for (; cur < end; cur += m_line_size)
+      asm volatile("DC CIVAC, %[addr]" : : [addr] "r" (cur) : "memory");
 #endif
+  }
+};
+
+const cache_engine&
+get_cache_engine()
+{
+  static cache_engine engine;
+  return engine;
+}
+
+const size_t huge_page_size = 2 * 1024 * 1024;
+
+// Back BOs of at least huge page size with transparent huge pages to cut
+// down TLB misses when CPU streams through them.
+bool
+use_huge_page()
+{
+  static bool huge =
+    xrt_core::config::detail::get_bool_value("Debug.bo_huge_page", false);
+  return huge;
+}
+
+bool
+is_huge_page_mapping(size_t size)
+{
+  return use_huge_page() && size >= huge_page_size;
+}
+
+// Alignment of host VA range for a BO. THP can only map huge page aligned
+// part of a VA range with huge pages.
+size_t
+host_alignment(size_t size, size_t alignment)
+{
+  return is_huge_page_mapping(size) ? std::max(alignment, huge_page_size) : alignment;
+}
+
+void
+advise_huge_page(void *addr, size_t size)
+{
+  if (!is_huge_page_mapping(size))
+    return;
+  // Best effort, kernel may have THP disabled or mapping may not support it.
+  if (madvise(addr, size, MADV_HUGEPAGE))
+    shim_debug("madvise(%p, 0x%lx, MADV_HUGEPAGE) failed: %d", addr, size, errno);
+}
+
+// Above this many bytes per sync, let driver do cache maintenance.
+// 0 means never.
+size_t
+get_driver_sync_threshold()
+{
+  static size_t threshold =
+    xrt_core::config::detail::get_uint_value("Debug.driver_sync_threshold", 0);
+  return threshold;
 }
 
 bool
@@ -207,6 +341,73 @@ bo_flags_to_type(uint64_t bo_flags, bool has_dev_mem)
 
 namespace shim_xdna {
 
+//
+// Impl for class range_set
+//
+
+void
+range_set::
+add(size_t offset, size_t size)
+{
+  if (!size)
+    return;
+
+  auto start = offset;
+  auto end = offset + size;
+  // Merge with all ranges overlapping or adjacent to [start, end).
+  auto it = m_ranges.upper_bound(start);
+  if (it != m_ranges.begin() && std::prev(it)->second >= start)
+    --it;
+  while (it != m_ranges.end() && it->first <= end) {
+    start = std::min(start, it->first);
+    end = std::max(end, it->second);
+    it = m_ranges.erase(it);
+  }
+  m_ranges.emplace(start, end);
+}
+
+bool
+range_set::
+covers(size_t offset, size_t size) const
+{
+  auto it = m_ranges.upper_bound(offset);
+  if (it == m_ranges.begin())
+    return false;
+  --it;
+  return it->first <= offset && it->second >= offset + size;
+}
+
+std::vector<std::pair<size_t, size_t>>
+range_set::
+intersect(size_t offset, size_t size, bool remove)
+{
+  std::vector<std::pair<size_t, size_t>> ret;
+  auto start = offset;
+  auto end = offset + size;
+
+  auto it = m_ranges.upper_bound(start);
+  if (it != m_ranges.begin() && std::prev(it)->second > start)
+    --it;
+  while (it != m_ranges.end() && it->first < end) {
+    auto s = std::max(start, it->first);
+    auto e = std::min(end, it->second);
+    ret.emplace_back(s, e - s);
+    if (!remove) {
+      ++it;
+      continue;
+    }
+    // Keep parts outside of [start, end).
+    auto rs = it->first;
+    auto re = it->second;
+    it = m_ranges.erase(it);
+    if (rs < s)
+      m_ranges.emplace(rs, s);
+    if (re > e)
+      it = m_ranges.emplace(e, re).first;
+  }
+  return ret;
+}
+
 //
 // Impl for class mmap_ptr
 //
@@ -241,6 +442,7 @@ mmap_ptr(size_t size, size_t alignment)
     // coverity[bad_free]
     munmap(reinterpret_cast<char*>(m_ptr) + m_size, total_sz - m_size);
   }
+  advise_huge_page(m_ptr, m_size);
 }
 
 mmap_ptr::
@@ -250,6 +452,8 @@ mmap_ptr(const pdev *dev, void *addr, uint64_t dev_offset, size_t size)
   int flags = addr ? MAP_FIXED : 0;
   m_ptr = dev->mmap(addr, size, PROT_READ | PROT_WRITE,
     MAP_SHARED | MAP_LOCKED | flags, dev_offset);
+  // MAP_FIXED mapping replaces the advice made on the reserved range.
+  advise_huge_page(m_ptr, size);
 }
 
 mmap_ptr::
@@ -355,16 +559,14 @@ drm_bo::
 
 buffer::
 buffer(const pdev& dev, size_t size, void *uptr, uint64_t flags)
-  : buffer(dev, size, bo_flags_to_type(flags, !!dev.get_heap_vaddr()), uptr)
+  : buffer(dev, size, bo_flags_to_type(flags, !!dev.get_heap_vaddr()), uptr, flags)
 {
-  m_flags = flags;
 }
 
 buffer::
 buffer(const pdev& dev, size_t size, uint64_t flags)
-  : buffer(dev, size, bo_flags_to_type(flags, !!dev.get_heap_vaddr()), nullptr)
+  : buffer(dev, size, bo_flags_to_type(flags, !!dev.get_heap_vaddr()), nullptr, flags)
 {
-  m_flags = flags;
 }
 
 buffer::
@@ -385,14 +587,24 @@ buffer(const pdev& dev, size_t initial_size, size_t max_size,
   if (m_type == AMDXDNA_BO_INVALID)
     shim_err(EINVAL, "Bad BO type.");
 
-  m_range_addr = std::make_unique<mmap_ptr>(m_total_size, m_alignment);
+  m_range_addr = std::make_unique<mmap_ptr>(m_total_size, host_alignment(m_total_size, m_alignment));
+  // BO may be expanded in background while others read m_bos[0], make sure
+  // m_bos never reallocates. Each chunk is at least m_alignment in size.
+  m_bos.reserve(m_total_size / m_alignment + 1);
   expand(initial_size);
   shim_debug("Created expandable %s", describe().c_str());
 }
 
 buffer::
 buffer(const pdev& dev, size_t size, int type, void *uptr)
+  : buffer(dev, size, type, uptr, 0)
+{
+}
+
+buffer::
+buffer(const pdev& dev, size_t size, int type, void *uptr, uint64_t flags)
   : m_pdev(dev)
+  , m_flags(flags)
   , m_uptr(uptr)
   , m_type(type)
   , m_total_size(size)
@@ -411,10 +623,29 @@ buffer(const pdev& dev, size_t size, int type, void *uptr)
   if (m_uptr && type != AMDXDNA_BO_SHARE)
     shim_err(EINVAL, "User pointer BO must be AMDXDNA_BO_SHARE type.");
 
+  if (!m_uptr && m_type == AMDXDNA_BO_SHARE && is_poolable(m_type, m_flags)) {
+    auto slab = m_pdev.get_slab_allocator();
+    if (slab && slab->chunk_size(m_total_size)) {
+      m_chunk = slab->alloc(m_total_size);
+      m_slab_alloc = std::move(slab);
+      m_cur_size = m_total_size;
+      sync(direction::host2device, m_cur_size, 0);
+      shim_debug("Created sub-allocated %s", describe().c_str());
+      return;
+    }
+  }
+
+  if (!m_uptr && is_poolable(m_type, m_flags)) {
+    m_pool = m_pdev.get_bo_pool();
+    if (m_pool && !m_pool->size_class(m_total_size))
+      m_pool.reset();
+  }
+
   // User ptr BO does not support mmap any more.
-  if (!m_uptr) {
+  // Pooled BO is mapped on its own since it may outlive this buffer.
+  if (!m_uptr && !m_pool) {
     // Prepare the mmap range for the entire buffer
-    m_range_addr = std::make_unique<mmap_ptr>(m_total_size, m_alignment);
+    m_range_addr = std::make_unique<mmap_ptr>(m_total_size, host_alignment(m_total_size, m_alignment));
   }
 
   // Obtain the buffer
@@ -431,16 +662,86 @@ buffer(const pdev& dev, xrt_core::shared_handle::export_handle ehdl)
 
   m_total_size = m_cur_size = bo->m_size;
   // Prepare the mmap range for the entire buffer
-  m_range_addr = std::make_unique<mmap_ptr>(m_total_size, m_alignment);
+  m_range_addr = std::make_unique<mmap_ptr>(m_total_size, host_alignment(m_total_size, m_alignment));
 
   mmap_drm_bo(bo.get());
   m_bos.push_back(std::move(bo));
+  m_nr_bos = m_bos.size();
   shim_debug("Imported %s", describe().c_str());
 }
 
 void
 buffer::
 expand(size_t size)
+{
+  // Background expansion in flight may have made the room caller needs.
+  if (wait_async_expand())
+    return;
+
+  std::lock_guard<std::mutex> lg(m_expand_lock);
+  expand_locked(size);
+}
+
+void
+buffer::
+expand_async(size_t size)
+{
+  std::lock_guard<std::mutex> lg(m_expand_lock);
+  if (m_cur_size >= m_total_size)
+    return;
+  if (m_async_expand.valid()) {
+    if (m_async_expand.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      return;
+    try {
+      m_async_expand.get();
+    } catch (const xrt_core::system_error& e) {
+      shim_debug("Background BO expansion failed: %s", e.what());
+    }
+  }
+
+  m_async_expand = std::async(std::launch::async, [this, size]() {
+    std::lock_guard<std::mutex> lg(m_expand_lock);
+    if (m_cur_size >= m_total_size)
+      return;
+    expand_locked(size);
+    m_expand_stats.m_async_expands++;
+  });
+}
+
+bool
+buffer::
+wait_async_expand()
+{
+  std::future<void> f;
+  {
+    std::lock_guard<std::mutex> lg(m_expand_lock);
+    if (!m_async_expand.valid())
+      return false;
+    f = std::move(m_async_expand);
+  }
+
+  try {
+    f.get();
+  } catch (const xrt_core::system_error& e) {
+    shim_debug("Background BO expansion failed: %s", e.what());
+    return false;
+  }
+  return true;
+}
+
+buffer::expand_stats
+buffer::
+get_expand_stats() const
+{
+  std::lock_guard<std::mutex> lg(m_expand_lock);
+  auto st = m_expand_stats;
+  st.m_chunks = m_nr_bos;
+  return st;
+}
+
+void
+buffer::
+expand_locked(size_t size)
 {
   size = (size + m_alignment - 1) & ~(m_alignment - 1);
 
@@ -450,32 +751,58 @@ expand(size_t size)
   if (size > m_total_size - m_cur_size)
     size = m_total_size - m_cur_size;
 
-  auto cur_sz = m_cur_size;
-  auto new_sz = size + m_cur_size;
+  size_t cur_sz = m_cur_size;
+  auto new_sz = size + cur_sz;
   shim_debug("Expanding BO from %zu to %zu", cur_sz, new_sz);
+  auto start = std::chrono::steady_clock::now();
 
   std::unique_ptr<drm_bo> bo;
-  if (m_uptr)
+  if (m_pool) {
+    auto bo_size = page_size_roundup(size);
+    bo = m_pool->get(m_type, bo_size);
+    if (bo) {
+      // Fresh BO is zeroed, don't leak previous user's data.
+      std::memset(bo->m_vaddr->get(), 0, bo->m_size);
+    } else {
+      bo = std::make_unique<drm_bo>(m_pdev, bo_size, m_type, m_alignment);
+      mmap_ptr range(bo_size, host_alignment(bo_size, m_alignment));
+      bo->m_vaddr = range.alloc(&m_pdev, bo->m_map_offset, bo_size);
+    }
+  } else if (m_uptr) {
     bo = std::make_unique<drm_bo>(m_pdev, size, m_uptr);
-  else
+  } else {
     bo = std::make_unique<drm_bo>(m_pdev, size, m_type, m_alignment);
+  }
   mmap_drm_bo(bo.get());
 
   m_bos.push_back(std::move(bo));
-  m_cur_size += size;
-  
+  m_nr_bos.store(m_bos.size(), std::memory_order_release);
+  m_cur_size.store(new_sz, std::memory_order_release);
+
   // Newly allocated buffer may contain dirty pages. If used as output buffer,
   // the data in cacheline will be flushed onto memory and pollute the output
   // from device. We perform a cache flush right after the BO is allocated to
   // avoid this issue.
   if (m_type == AMDXDNA_BO_SHARE)
     sync(direction::host2device, size, cur_sz);
+
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start).count();
+  m_expand_stats.m_expands++;
+  m_expand_stats.m_last_us = us;
+  m_expand_stats.m_max_us = std::max<uint64_t>(m_expand_stats.m_max_us, us);
+  m_expand_stats.m_total_us += us;
 }
 
 buffer::
 ~buffer()
 {
+  wait_async_expand();
   shim_debug("Destroying %s", describe().c_str());
+  if (m_slab_alloc)
+    m_slab_alloc->free(m_chunk);
+  if (m_pool && !m_exported && m_bos.size() == 1)
+    m_pool->put(m_type, std::move(m_bos[0]));
 }
 
 void
@@ -509,6 +836,9 @@ vaddr() const
   if (m_uptr)
     return m_uptr;
 
+  if (m_chunk.m_slab)
+    return static_cast<char*>(m_chunk.m_slab->get_bo().m_vaddr->get()) + m_chunk.m_offset;
+
   auto& bo = m_bos[0];
   if (bo->m_map_offset != AMDXDNA_INVALID_ADDR)
     return reinterpret_cast<char*>(bo->m_vaddr->get());
@@ -522,7 +852,7 @@ size_t
 buffer::
 size() const
 {
-  return m_cur_size;
+  return m_cur_size.load(std::memory_order_acquire);
 }
 
 void
@@ -543,11 +873,15 @@ std::unique_ptr<xrt_core::shared_handle>
 buffer::
 share() const 
 {
+  if (m_chunk.m_slab)
+    shim_err(ENOTSUP, "Sub-allocated BO %d+0x%lx can't be exported", id().handle, m_chunk.m_offset);
+
   export_bo_arg arg = {
     .bo = id(),
     .fd = -1,
   };
   m_pdev.drv_ioctl(drv_ioctl_cmd::export_bo, &arg);
+  m_exported = true;
 
   shim_debug("Exported BO %d to fd %d", id().handle, arg.fd);
   return std::make_unique<shared>(arg.fd);
@@ -580,6 +914,10 @@ bo_id
 buffer::
 id(int index) const
 {
+  if (m_chunk.m_slab)
+    return m_chunk.m_slab->get_bo().m_id;
+  if (static_cast<size_t>(index) >= m_nr_bos.load(std::memory_order_acquire))
+    shim_err(EINVAL, "BO chunk index %d is out of range", index);
   return m_bos[index]->m_id;
 }
 
@@ -587,6 +925,13 @@ uint64_t
 buffer::
 paddr() const
 {
+  if (m_chunk.m_slab) {
+    auto& bo = m_chunk.m_slab->get_bo();
+    if (bo.m_xdna_addr != AMDXDNA_INVALID_ADDR)
+      return bo.m_xdna_addr + m_chunk.m_offset;
+    return reinterpret_cast<uint64_t>(vaddr());
+  }
+
   auto xdna_addr = m_bos[0]->m_xdna_addr;
   if (xdna_addr != AMDXDNA_INVALID_ADDR)
     return xdna_addr;
@@ -623,10 +968,17 @@ describe() const
   std::string desc = type_to_name(m_type, m_flags) + ": ";
 
   desc += "hdl=";
-  for (long unsigned int i = 0; i < m_bos.size(); i++) {
+  const auto nr_bos = m_nr_bos.load(std::memory_order_acquire);
+  for (size_t i = 0; i < nr_bos; i++) {
     desc += std::to_string(id(i).handle);
     desc += " ";
   }
+  if (m_chunk.m_slab) {
+    desc += std::to_string(id().handle);
+    desc += "+";
+    desc += to_hex_string(m_chunk.m_offset);
+    desc += " ";
+  }
 
   desc += "sz=";
   desc += to_hex_string(size());
@@ -655,7 +1007,7 @@ sync_by_driver(direction dir, size_t sz, size_t offset)
   sync_bo_arg arg = {
     .bo = id(),
     .direction = dir,
-    .offset = offset,
+    .offset = offset + m_chunk.m_offset,
     .size = sz,
   };
   m_pdev.drv_ioctl(drv_ioctl_cmd::sync_bo, &arg);
@@ -665,19 +1017,93 @@ sync_by_driver(direction dir, size_t sz, size_t offset)
 void
 buffer::
 sync(direction dir, size_t sz, size_t offset)
+{
+  std::vector<std::pair<size_t, size_t>> ranges;
+  if (!m_track_dirty) {
+    ranges.emplace_back(offset, sz);
+  } else {
+    std::lock_guard<std::mutex> lg(m_dirty_lock);
+    if (dir == xrt_core::buffer_handle::direction::host2device) {
+      ranges = m_dirty.intersect(offset, sz, true);
+    } else if (!m_dev_access.empty()) {
+      ranges = m_dev_access.intersect(offset, sz, false);
+    } else {
+      // Don't know where device writes, sync it all.
+      ranges.emplace_back(offset, sz);
+    }
+  }
+  // Cache maintenance or driver sync may take long, not under the lock.
+  if (!ranges.empty())
+    sync_ranges(dir, ranges);
+}
+
+void
+buffer::
+enable_dirty_tracking()
+{
+  m_track_dirty = true;
+}
+
+void
+buffer::
+mark_dirty(size_t offset, size_t sz)
+{
+  if (offset > size() || sz > size() - offset)
+    shim_err(EINVAL, "Invalid BO offset and size for marking dirty: %ld, %ld", offset, sz);
+
+  std::lock_guard<std::mutex> lg(m_dirty_lock);
+  m_track_dirty = true;
+  m_dirty.add(offset, sz);
+}
+
+void *
+buffer::
+map_range(size_t offset, size_t sz)
+{
+  mark_dirty(offset, sz);
+  return static_cast<char *>(vaddr()) + offset;
+}
+
+void
+buffer::
+mark_device_access(size_t offset, size_t sz) const
+{
+  // Nothing uses it unless dirty tracking is on.
+  if (!m_track_dirty)
+    return;
+  if (offset > size() || sz > size() - offset)
+    return;
+
+  std::lock_guard<std::mutex> lg(m_dirty_lock);
+  // Same range is bound again and again, no need to update the set.
+  if (!m_dev_access.covers(offset, sz))
+    m_dev_access.add(offset, sz);
+}
+
+void
+buffer::
+sync_ranges(direction dir, const std::vector<std::pair<size_t, size_t>>& ranges)
 {
   if (m_pdev.is_cache_coherent())
     return;
 
-  if (is_driver_sync()) {
-    sync_by_driver(dir, sz, offset);
+  size_t total = 0;
+  for (auto& [offset, sz] : ranges) {
+    if (offset > size() || sz > size() - offset)
+      shim_err(EINVAL, "Invalid BO offset and size for sync'ing: %ld, %ld", offset, sz);
+    total += sz;
+  }
+
+  auto threshold = get_driver_sync_threshold();
+  if (is_driver_sync() || (threshold && total >= threshold)) {
+    for (auto& [offset, sz] : ranges)
+      sync_by_driver(dir, sz, offset);
     return;
   }
 
-  if (offset > size() || sz > size() - offset)
-    shim_err(EINVAL, "Invalid BO offset and size for sync'ing: %ld, %ld", offset, sz);
-  clflush_data(vaddr(), offset, sz); 
-  shim_debug("Sync'ed BO %d: offset=%ld, size=%ld", id().handle, offset, sz);
+  get_cache_engine().sync(static_cast<const char *>(vaddr()), ranges,
+    dir == xrt_core::buffer_handle::direction::host2device);
+  shim_debug("Sync'ed BO %d: %ld ranges, %ld bytes", id().handle, ranges.size(), total);
 }
 
 std::set<bo_id>
@@ -745,13 +1171,27 @@ void
 cmd_buffer::
 bind_at(size_t pos, const buffer_handle* bh, size_t offset, size_t size)
 {
+  auto boh = reinterpret_cast<const buffer*>(bh);
+  // Device may only touch what is bound, which is all sync from device
+  // needs to take care of.
+  boh->mark_device_access(offset, size);
+
   if (!is_driver_pin_arg_bo())
     return;
 
-  auto boh = reinterpret_cast<const buffer*>(bh);
+  auto ids = boh->get_arg_bo_ids();
   std::lock_guard<std::mutex> lg(m_args_map_lock);
 
-  m_args_map[pos] = boh->get_arg_bo_ids();
+  auto& cur = m_args_map[pos];
+  // Rebinding same BO at same position is common, nothing changes.
+  if (cur != ids) {
+    // Copy on write, submitters may still hold current handles.
+    auto hdls = *m_arg_handles;
+    remove_arg_bo_handles(cur, hdls);
+    add_arg_bo_handles(ids, hdls);
+    m_arg_handles = std::make_shared<const std::vector<uint32_t>>(std::move(hdls));
+    cur = std::move(ids);
+  }
 
   // Collecting BO handles for dumping BO content before cmd submission.
   // BO content dumping out is off by default.
@@ -775,6 +1215,44 @@ reset()
   std::lock_guard<std::mutex> lg(m_args_map_lock);
   m_args_map.clear();
   m_arg_bos_map.clear();
+  if (!m_arg_handles->empty())
+    m_arg_handles = std::make_shared<const std::vector<uint32_t>>();
+  m_arg_handle_refs.clear();
+}
+
+void
+cmd_buffer::
+add_arg_bo_handles(const std::set<bo_id>& ids, std::vector<uint32_t>& hdls)
+{
+  for (const auto& id : ids) {
+    if (m_arg_handle_refs[id.handle]++)
+      continue;
+    auto it = std::lower_bound(hdls.begin(), hdls.end(), id.handle);
+    hdls.insert(it, id.handle);
+  }
+}
+
+void
+cmd_buffer::
+remove_arg_bo_handles(const std::set<bo_id>& ids, std::vector<uint32_t>& hdls)
+{
+  for (const auto& id : ids) {
+    auto ref = m_arg_handle_refs.find(id.handle);
+    if (ref == m_arg_handle_refs.end() || --ref->second)
+      continue;
+    m_arg_handle_refs.erase(ref);
+    auto it = std::lower_bound(hdls.begin(), hdls.end(), id.handle);
+    if (it != hdls.end() && *it == id.handle)
+      hdls.erase(it);
+  }
+}
+
+std::shared_ptr<const std::vector<uint32_t>>
+cmd_buffer::
+get_arg_bo_handles() const
+{
+  std::lock_guard<std::mutex> lg(m_args_map_lock);
+  return m_arg_handles;
 }
 
 std::set<bo_id>
@@ -8,13 +8,42 @@
 #include "shared.h"
 #include "hwctx.h"
 #include "shim_debug.h"
+#include "bo_pool.h"
 #include "core/common/shim/hwctx_handle.h"
 #include "core/common/shim/buffer_handle.h"
 #include <set>
+#include <atomic>
+#include <future>
+#include <map>
+#include <mutex>
 #include "drm_local/amdxdna_accel.h"
 
 namespace shim_xdna {
 
+// Set of non-overlapping [offset, offset + size) intervals, adjacent ones merged.
+class range_set {
+public:
+  void
+  add(size_t offset, size_t size);
+
+  // Parts of [offset, offset + size) covered by the set as {offset, size}.
+  // Returned parts are removed from the set if remove is true.
+  std::vector<std::pair<size_t, size_t>>
+  intersect(size_t offset, size_t size, bool remove);
+
+  bool
+  empty() const
+  { return m_ranges.empty(); }
+
+  // True if [offset, offset + size) is entirely in one range of the set.
+  bool
+  covers(size_t offset, size_t size) const;
+
+private:
+  // Start -> end
+  std::map<size_t, size_t> m_ranges;
+};
+
 class mmap_ptr {
 public:
   mmap_ptr(size_t size, size_t alignment);
@@ -59,6 +88,7 @@ public:
   buffer(const pdev& dev, size_t size, uint64_t flags);
   buffer(const pdev& dev, size_t size, void *uptr, uint64_t flags);
   buffer(const pdev& dev, xrt_core::shared_handle::export_handle ehdl);
+  buffer(const pdev& dev, size_t size, int type, void *uptr, uint64_t flags);
   virtual ~buffer();
 
   void
@@ -121,6 +151,44 @@ public:
   void
   expand(size_t size);
 
+  // Grow expandable BO by size on a helper thread ahead of time. No-op if
+  // one is already in flight or BO is at max size.
+  void
+  expand_async(size_t size);
+
+  struct expand_stats {
+    size_t m_chunks = 0;
+    uint64_t m_expands = 0;
+    uint64_t m_async_expands = 0;
+    uint64_t m_last_us = 0;
+    uint64_t m_max_us = 0;
+    uint64_t m_total_us = 0;
+  };
+
+  expand_stats
+  get_expand_stats() const;
+
+  // Sync a list of {offset, size} ranges with one round of cache maintenance.
+  void
+  sync_ranges(direction dir, const std::vector<std::pair<size_t, size_t>>& ranges);
+
+  // Opt-in dirty range tracking. Once enabled, sync to device only flushes
+  // ranges marked dirty since last sync, and sync from device only
+  // invalidates ranges device may write, as declared by bind_at().
+  // Calling mark_dirty() or map_range() enables it.
+  void
+  enable_dirty_tracking();
+
+  void
+  mark_dirty(size_t offset, size_t size);
+
+  // Pointer to [offset, offset + size) of BO which caller is going to write.
+  void *
+  map_range(size_t offset, size_t size);
+
+  void
+  mark_device_access(size_t offset, size_t size) const;
+
 protected:
   const pdev& m_pdev;
 
@@ -134,6 +202,29 @@ private:
   void
   mmap_drm_bo(drm_bo *bo); // Obtain void* through mmap()
 
+  // Caller holds m_expand_lock.
+  void
+  expand_locked(size_t size);
+
+  // Wait for in flight background expansion, true if it succeeded.
+  bool
+  wait_async_expand();
+
+  // Sub-allocated from a slab, in which case m_bos is empty.
+  std::shared_ptr<slab_allocator> m_slab_alloc;
+  slab_allocator::chunk m_chunk;
+
+  // BO is taken from and returned to device BO pool when m_pool is set.
+  std::shared_ptr<bo_pool> m_pool;
+  // Exported BO can't be reused since it might still be used by others.
+  mutable bool m_exported = false;
+
+  // Read without lock on bind path, only turned on once.
+  std::atomic<bool> m_track_dirty{false};
+  range_set m_dirty;
+  mutable range_set m_dev_access;
+  mutable std::mutex m_dirty_lock;
+
   uint64_t m_flags = 0;
   std::unique_ptr<mmap_ptr> m_range_addr = nullptr;
   std::vector< std::unique_ptr<drm_bo> > m_bos;
@@ -141,7 +232,14 @@ private:
   int m_type = AMDXDNA_BO_INVALID;
   size_t m_alignment = 1;
   size_t m_total_size = 0;
-  size_t m_cur_size = 0;
+  // Both are published after m_bos is appended, so lockless readers seeing
+  // the new value also see the new chunk in m_bos.
+  std::atomic<size_t> m_cur_size = 0;
+  std::atomic<size_t> m_nr_bos = 0;
+
+  mutable std::mutex m_expand_lock;
+  std::future<void> m_async_expand;
+  expand_stats m_expand_stats;
 };
 
 class cmd_buffer : public buffer
@@ -173,10 +271,27 @@ public:
   std::set<const buffer *>
   get_arg_bos() const override;
 
+  // Sorted and deduplicated handles of all arg BOs, ready to be passed to
+  // driver as is. Snapshot is never changed, bind_at() and reset() replace it.
+  std::shared_ptr<const std::vector<uint32_t>>
+  get_arg_bo_handles() const;
+
 private:
+  // Caller holds m_args_map_lock.
+  void
+  add_arg_bo_handles(const std::set<bo_id>& ids, std::vector<uint32_t>& hdls);
+
+  void
+  remove_arg_bo_handles(const std::set<bo_id>& ids, std::vector<uint32_t>& hdls);
+
   // Valid only when m_submitted is true.
   mutable uint64_t m_cmd_seq = 0;
   std::map< size_t, std::set<bo_id> > m_args_map;
+  // Flattened handles from m_args_map and how many positions refer to each,
+  // maintained when args are bound so that submission does no work.
+  std::shared_ptr<const std::vector<uint32_t>> m_arg_handles =
+    std::make_shared<const std::vector<uint32_t>>();
+  std::map< uint32_t, size_t > m_arg_handle_refs;
   // For dumping arg BO content only
   std::map< size_t, std::set<const buffer *> > m_arg_bos_map;
   bool m_dump_arg_bos = false;
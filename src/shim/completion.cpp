@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2026, Advanced Micro Devices, Inc. All rights reserved.
+
+#include "completion.h"
+#include "pcidev.h"
+#include "shim_debug.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+namespace shim_xdna {
+
+completion_reactor::
+completion_reactor(const pdev& dev)
+  : m_pdev(dev)
+{
+  create_destroy_syncobj_arg arg = {};
+  m_pdev.drv_ioctl(drv_ioctl_cmd::create_syncobj, &arg);
+  m_kick_syncobj = arg.handle;
+  // Reactor thread should be created as the last step.
+  m_thread = std::thread(&completion_reactor::run, this);
+}
+
+completion_reactor::
+~completion_reactor()
+{
+  std::vector<waiter> left;
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_stop = true;
+    try {
+      kick();
+    } catch (const xrt_core::system_error& e) {
+      shim_debug("Failed to kick completion reactor: %s", e.what());
+    }
+  }
+  m_cv.notify_all();
+  m_thread.join();
+
+  left.swap(m_waiters);
+  for (auto& w : left)
+    w.m_cb(ECANCELED);
+
+  try {
+    create_destroy_syncobj_arg arg = { .handle = m_kick_syncobj };
+    m_pdev.drv_ioctl(drv_ioctl_cmd::destroy_syncobj, &arg);
+  } catch (const xrt_core::system_error& e) {
+    shim_debug("Failed to destroy reactor syncobj: %s", e.what());
+  }
+}
+
+void
+completion_reactor::
+kick()
+{
+  // Caller holds m_lock.
+  signal_syncobj_arg arg = {
+    .handle = m_kick_syncobj,
+    .timepoint = ++m_kick_point,
+  };
+  m_pdev.drv_ioctl(drv_ioctl_cmd::signal_syncobj, &arg);
+}
+
+void
+completion_reactor::
+add(uint32_t syncobj, uint64_t point, callback cb)
+{
+  if (syncobj == AMDXDNA_INVALID_FENCE_HANDLE)
+    shim_err(EINVAL, "Invalid syncobj for completion notification");
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (m_stop)
+    shim_err(EINVAL, "Completion reactor is stopped");
+  m_waiters.push_back({ syncobj, point, std::move(cb) });
+  // New waiter is not in the list reactor is blocked on.
+  if (m_in_wait)
+    kick();
+  else
+    m_cv.notify_all();
+}
+
+void
+completion_reactor::
+remove(uint32_t syncobj)
+{
+  std::vector<waiter> removed;
+  {
+    std::unique_lock<std::mutex> lock(m_lock);
+    auto it = std::stable_partition(m_waiters.begin(), m_waiters.end(),
+      [syncobj](const waiter& w) { return w.m_syncobj != syncobj; });
+    std::move(it, m_waiters.end(), std::back_inserter(removed));
+    m_waiters.erase(it, m_waiters.end());
+
+    // Make sure reactor is no longer waiting on the syncobj. Reactor thread,
+    // e.g. from a callback, is not in any wait.
+    if (m_in_wait && !removed.empty() && std::this_thread::get_id() != m_thread.get_id()) {
+      auto gen = m_wait_gen;
+      kick();
+      m_cv.wait(lock, [this, gen]() { return m_stop || m_wait_gen != gen; });
+    }
+  }
+
+  for (auto& w : removed)
+    w.m_cb(ECANCELED);
+}
+
+void
+completion_reactor::
+wait_and_query(const std::vector<uint32_t>& handles, const std::vector<uint64_t>& points,
+  std::vector<uint64_t>& cur_points)
+{
+  wait_syncobjs_arg warg = {
+    .handles = handles,
+    .timepoints = points,
+    .timeout_ms = 0, // Wait forever, kick syncobj breaks us out
+    .wait_all = false,
+  };
+  while (true) {
+    try {
+      m_pdev.drv_ioctl(drv_ioctl_cmd::wait_syncobjs, &warg);
+      break;
+    } catch (const xrt_core::system_error& e) {
+      // Interrupted wait says nothing about the syncobjs, just wait again.
+      if (std::abs(e.get_code()) != EINTR)
+        throw;
+    }
+  }
+
+  // More than one syncobj may have been signaled, find out all of them.
+  query_syncobjs_arg qarg = {
+    .handles = handles,
+    .timepoints = cur_points,
+  };
+  m_pdev.drv_ioctl(drv_ioctl_cmd::query_syncobjs, &qarg);
+}
+
+void
+completion_reactor::
+query_each(const std::vector<uint32_t>& handles, std::vector<uint64_t>& cur_points,
+  std::vector<int>& errs)
+{
+  // One bad syncobj fails the whole multi-handle wait, find out which.
+  std::vector<uint32_t> h(1);
+  std::vector<uint64_t> p(1);
+  cur_points.assign(handles.size(), 0);
+  errs.assign(handles.size(), 0);
+  for (size_t i = 0; i < handles.size(); i++) {
+    h[0] = handles[i];
+    query_syncobjs_arg qarg = {
+      .handles = h,
+      .timepoints = p,
+    };
+    try {
+      m_pdev.drv_ioctl(drv_ioctl_cmd::query_syncobjs, &qarg);
+      cur_points[i] = p[0];
+    } catch (const xrt_core::system_error& e) {
+      shim_debug("Query syncobj %d failed: %s", handles[i], e.what());
+      errs[i] = e.get_code() ? std::abs(e.get_code()) : EIO;
+    }
+  }
+}
+
+void
+completion_reactor::
+run()
+{
+  std::vector<uint32_t> handles;
+  std::vector<uint64_t> points;
+  std::vector<uint64_t> cur_points;
+  std::vector<int> errs;
+
+  shim_debug("Completion reactor started!");
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      m_cv.wait(lock, [this]() { return m_stop || !m_waiters.empty(); });
+      if (m_stop)
+        break;
+
+      // One entry per syncobj at the lowest point waited on, plus kick syncobj.
+      handles.clear();
+      points.clear();
+      for (const auto& w : m_waiters) {
+        auto it = std::find(handles.begin(), handles.end(), w.m_syncobj);
+        if (it == handles.end()) {
+          handles.push_back(w.m_syncobj);
+          points.push_back(w.m_point);
+        } else {
+          auto& p = points[it - handles.begin()];
+          p = std::min(p, w.m_point);
+        }
+      }
+      handles.push_back(m_kick_syncobj);
+      points.push_back(m_kick_point + 1);
+      m_in_wait = true;
+    }
+
+    int err = 0;
+    try {
+      wait_and_query(handles, points, cur_points);
+      errs.assign(handles.size(), 0);
+    } catch (const xrt_core::system_error& e) {
+      shim_debug("Completion reactor wait failed: %s", e.what());
+      err = e.get_code() ? std::abs(e.get_code()) : EIO;
+      query_each(handles, cur_points, errs);
+    }
+    // Fail all waiters only if no syncobj can be blamed and none is done, or
+    // reactor would spin on the same failing wait.
+    bool fail_all = err != 0;
+    for (size_t i = 0; fail_all && i < handles.size(); i++) {
+      // Last one is the kick syncobj, no waiter to blame.
+      if ((errs[i] && i + 1 < handles.size()) || (!errs[i] && cur_points[i] >= points[i]))
+        fail_all = false;
+    }
+
+    // Collect waiters that are done and call them back outside of the lock.
+    std::vector<std::pair<waiter, int>> done;
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      m_in_wait = false;
+      m_wait_gen++;
+      auto it = std::stable_partition(m_waiters.begin(), m_waiters.end(),
+        [&](const waiter& w) {
+          auto h = std::find(handles.begin(), handles.end(), w.m_syncobj);
+          // Added after the wait started, keep for next round.
+          if (h == handles.end())
+            return true;
+          auto i = h - handles.begin();
+          // Nothing can be told about the syncobj waited on.
+          if (fail_all || errs[i])
+            return false;
+          return cur_points[i] < w.m_point;
+        });
+      for (auto d = it; d != m_waiters.end(); ++d) {
+        auto i = std::find(handles.begin(), handles.end(), d->m_syncobj) - handles.begin();
+        int e = fail_all ? err : errs[i];
+        done.push_back({ std::move(*d), e });
+      }
+      m_waiters.erase(it, m_waiters.end());
+    }
+    m_cv.notify_all();
+
+    for (auto& [w, werr] : done) {
+      try {
+        w.m_cb(werr);
+      } catch (const std::exception& e) {
+        shim_debug("Completion callback failed: %s", e.what());
+      }
+    }
+  }
+
+  shim_debug("Completion reactor stopped!");
+}
+
+}
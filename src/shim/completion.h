@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2026, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef COMPLETION_XDNA_H
+#define COMPLETION_XDNA_H
+
+#include "platform.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace shim_xdna {
+
+class pdev;
+
+// One thread per device waiting on timeline syncobjs of all hw contexts with
+// a single multi-handle wait. Waiters are called back from this thread once
+// their syncobj reaches the point they are waiting for.
+class completion_reactor
+{
+public:
+  // Called with 0 when the point is reached, or an error code when the wait
+  // is cancelled or failed.
+  using callback = std::function<void(int)>;
+
+  completion_reactor(const pdev& dev);
+  ~completion_reactor();
+
+  void
+  add(uint32_t syncobj, uint64_t point, callback cb);
+
+  // Cancel all waiters on the syncobj. Reactor no longer touches the syncobj
+  // once this returns, so it can be destroyed by caller.
+  void
+  remove(uint32_t syncobj);
+
+private:
+  struct waiter {
+    uint32_t m_syncobj;
+    uint64_t m_point;
+    callback m_cb;
+  };
+
+  void
+  run();
+
+  void
+  kick();
+
+  void
+  wait_and_query(const std::vector<uint32_t>& handles, const std::vector<uint64_t>& points,
+    std::vector<uint64_t>& cur_points);
+
+  // Query syncobjs one by one, errs tells which ones can't be queried.
+  void
+  query_each(const std::vector<uint32_t>& handles, std::vector<uint64_t>& cur_points,
+    std::vector<int>& errs);
+
+  const pdev& m_pdev;
+  // Signaled to break reactor out of current wait when waiter list changes.
+  uint32_t m_kick_syncobj = AMDXDNA_INVALID_FENCE_HANDLE;
+  uint64_t m_kick_point = 0;
+
+  std::mutex m_lock;
+  std::condition_variable m_cv;
+  std::vector<waiter> m_waiters;
+  bool m_stop = false;
+  // Reactor is blocked in driver with a snapshot of m_waiters.
+  bool m_in_wait = false;
+  // Bumped each time reactor comes back from a wait, so that a waiter on the
+  // old snapshot can tell it is over even if reactor is already in next wait.
+  uint64_t m_wait_gen = 0;
+  std::thread m_thread;
+};
+
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "device.h"
 #include "buffer.h"
+#include "bo_pool.h"
 #include "kmq/hwctx.h"
 #include "umq/hwctx.h"
 #include "fence.h"
@@ -627,6 +628,45 @@ struct total_mem_usage
   }
 };
 
+// Counters of device BO pool and heap, one "name value" pair per line.
+struct mem_stats
+{
+  using result_type = query::memstat_raw::result_type;
+
+  static result_type
+  get(const xrt_core::device* device, key_type key)
+  {
+    result_type output;
+    auto& pdev = get_pcidev_impl(device);
+
+    auto heap = pdev.get_heap_bo();
+    if (heap) {
+      auto est = heap->get_expand_stats();
+      output.push_back("heap_size " + std::to_string(heap->size()));
+      output.push_back("heap_chunks " + std::to_string(est.m_chunks));
+      output.push_back("heap_expands " + std::to_string(est.m_expands));
+      output.push_back("heap_async_expands " + std::to_string(est.m_async_expands));
+      output.push_back("heap_expand_last_us " + std::to_string(est.m_last_us));
+      output.push_back("heap_expand_max_us " + std::to_string(est.m_max_us));
+      output.push_back("heap_expand_total_us " + std::to_string(est.m_total_us));
+    }
+
+    auto pool = pdev.get_bo_pool();
+    if (!pool)
+      return output;
+
+    auto st = pool->get_stats();
+    output.push_back("bo_pool_hits " + std::to_string(st.m_hits));
+    output.push_back("bo_pool_misses " + std::to_string(st.m_misses));
+    output.push_back("bo_pool_recycled " + std::to_string(st.m_recycled));
+    output.push_back("bo_pool_dropped " + std::to_string(st.m_dropped));
+    output.push_back("bo_pool_trimmed " + std::to_string(st.m_trimmed));
+    output.push_back("bo_pool_cached_bos " + std::to_string(st.m_cached_bos));
+    output.push_back("bo_pool_cached_bytes " + std::to_string(st.m_cached_bytes));
+    return output;
+  }
+};
+
 struct context_health_info {
 
   static xrt_core::query::context_health_info::smi_context_health
@@ -2240,6 +2280,7 @@ initialize_query_table()
   emplace_func0_request<query::pcie_bdf,                       bdf>();
   emplace_func0_request<query::pcie_id,                        pcie_id>();
   emplace_func0_request<query::total_cols,                     total_cols>();
+  emplace_func0_request<query::memstat_raw,                    mem_stats>();
   emplace_sysfs_get<query::pcie_device>                        ("", "device");
   emplace_sysfs_get<query::pcie_express_lane_width>            ("", "link_width");
   emplace_sysfs_get<query::pcie_express_lane_width_max>        ("", "link_width_max");
@@ -2,6 +2,7 @@
 // Copyright (C) 2024-2025, Advanced Micro Devices, Inc. All rights reserved.
 
 #include "fence.h"
+#include <cstdlib>
 
 namespace {
 
@@ -129,6 +130,7 @@ uint64_t
 fence::
 get_next_state() const
 {
+  std::lock_guard<std::mutex> guard(m_lock);
   return m_state + 1;
 }
 
@@ -150,6 +152,18 @@ next_wait_state() const
   return ++m_state;
 }
 
+void
+fence::
+unreserve_wait_state(uint64_t state) const
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+
+  if (m_state == state)
+    --m_state;
+  else
+    shim_debug("Fence %d moved to %ld, can't give back %ld", m_syncobj_hdl, m_state, state);
+}
+
 void
 fence::
 wait(uint64_t state) const
@@ -194,6 +208,115 @@ signal() const
   signal(next_signal_state());
 }
 
+std::unique_ptr<fence>
+fence::
+import_sync_file(const device& device, int fd)
+{
+  auto f = std::make_unique<fence>(device);
+  // First wait on the fence is for the point right after initial state.
+  sync_file_arg arg = {
+    .handle = f->m_syncobj_hdl,
+    .timepoint = initial_state + 1,
+    .fd = fd,
+  };
+  f->m_pdev.drv_ioctl(drv_ioctl_cmd::import_sync_file, &arg);
+  shim_debug("Fence imported from sync_file %d: %d", fd, f->m_syncobj_hdl);
+  return f;
+}
+
+int
+fence::
+export_sync_file() const
+{
+  uint64_t state;
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (m_state == initial_state || !m_signaled)
+      shim_err(EINVAL, "Can't export fence which has not been signaled.");
+    state = m_state;
+  }
+
+  sync_file_arg arg = {
+    .handle = m_syncobj_hdl,
+    .timepoint = state,
+    .fd = -1,
+  };
+  m_pdev.drv_ioctl(drv_ioctl_cmd::export_sync_file, &arg);
+  return arg.fd;
+}
+
+int
+fence::
+wait_many(const std::vector<const fence*>& fences, uint32_t timeout_ms, bool wait_all)
+{
+  if (fences.empty())
+    shim_err(EINVAL, "No fence to wait on");
+
+  auto& dev = fences.front()->m_pdev;
+  std::vector<uint32_t> handles;
+  std::vector<uint64_t> points;
+  handles.reserve(fences.size());
+  points.reserve(fences.size());
+  for (auto f : fences) {
+    if (&f->m_pdev != &dev)
+      shim_err(EINVAL, "Can't wait on fences from different devices");
+  }
+
+  // Reserve points under fence lock, same as single wait, so that concurrent
+  // waiters never end up waiting on the same point.
+  auto unreserve = [&fences, &points] (int keep) {
+    for (size_t i = points.size(); i-- > 0;) {
+      if (static_cast<int>(i) != keep)
+        fences[i]->unreserve_wait_state(points[i]);
+    }
+  };
+  try {
+    for (auto f : fences) {
+      handles.push_back(f->m_syncobj_hdl);
+      points.push_back(f->next_wait_state());
+    }
+  } catch (...) {
+    unreserve(-1);
+    throw;
+  }
+
+  wait_syncobjs_arg warg = {
+    .handles = handles,
+    .timepoints = points,
+    .timeout_ms = timeout_ms,
+    .wait_all = wait_all,
+    .first_signaled = 0,
+  };
+  try {
+    dev.drv_ioctl(drv_ioctl_cmd::wait_syncobjs, &warg);
+  } catch (const xrt_core::system_error& ex) {
+    unreserve(-1);
+    if (std::abs(ex.get_code()) != ETIME)
+      throw;
+    return -1;
+  }
+
+  // Only the signaled fence keeps its point when waiting for any.
+  if (!wait_all)
+    unreserve(static_cast<int>(warg.first_signaled));
+  shim_debug("Waited for %ld fences, first signaled %d", fences.size(), warg.first_signaled);
+  return static_cast<int>(warg.first_signaled);
+}
+
+int
+fence::
+wait_any(const std::vector<const fence*>& fences, uint32_t timeout_ms)
+{
+  return wait_many(fences, timeout_ms, false);
+}
+
+bool
+fence::
+wait_all(const std::vector<const fence*>& fences, uint32_t timeout_ms)
+{
+  return wait_many(fences, timeout_ms, true) >= 0;
+}
+
 const std::string
 fence::
 describe() const
@@ -9,6 +9,7 @@
 #include "shared.h"
 #include "core/common/shim/fence_handle.h"
 #include <mutex>
+#include <vector>
 
 namespace shim_xdna {
 
@@ -52,7 +53,41 @@ public:
   void
   signal(uint64_t state) const;
 
+  uint32_t
+  get_syncobj() const
+  { return m_syncobj_hdl; }
+
+  // Fence to be waited on once, which is signaled with the sync_file. Caller
+  // still owns fd.
+  static std::unique_ptr<fence>
+  import_sync_file(const device& device, int fd);
+
+  // Export last signaled state as sync_file fd, owned by caller. Fence share()
+  // exports syncobj instead, which only DRM drivers understand.
+  int
+  export_sync_file() const;
+
+  // Wait for the first of fences to be signaled in one driver call. Returns
+  // its index, or -1 on timeout. Only the signaled fence moves to next state.
+  // Timeout of 0 means waiting forever.
+  static int
+  wait_any(const std::vector<const fence*>& fences, uint32_t timeout_ms);
+
+  // Wait for all fences to be signaled in one driver call. Returns false on
+  // timeout, in which case none of fences moves to next state.
+  static bool
+  wait_all(const std::vector<const fence*>& fences, uint32_t timeout_ms);
+
 private:
+  // Returns index of first signaled fence, or -1 on timeout.
+  static int
+  wait_many(const std::vector<const fence*>& fences, uint32_t timeout_ms, bool wait_all);
+
+  // Give back a point reserved by next_wait_state() but not waited on. Only
+  // possible if nobody has moved the fence beyond it since.
+  void
+  unreserve_wait_state(uint64_t state) const;
+
   const pdev& m_pdev;
   const std::unique_ptr<xrt_core::shared_handle> m_import;
   uint32_t m_syncobj_hdl;
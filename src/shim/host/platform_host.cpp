@@ -279,22 +279,97 @@ submit_cmd(submit_cmd_arg& cmd_arg) const
   if (nargs > max_args)
     shim_err(EINVAL, "Max arg %ld, received %ld", max_args, nargs);
 
-  uint32_t arg_bo_hdls[max_args] = {};
-  int i = 0;
-  for (auto& id : cmd_arg.arg_bos)
-    arg_bo_hdls[i++] = id.handle;
-
   amdxdna_drm_exec_cmd arg = {};
   arg.hwctx = cmd_arg.ctx_handle;
   arg.type = AMDXDNA_CMD_SUBMIT_EXEC_BUF;
   arg.cmd_handles = cmd_arg.cmd_bo.handle;
-  arg.args = reinterpret_cast<uintptr_t>(arg_bo_hdls);
+  // Arg handles are already in the layout driver wants, no copy needed.
+  arg.args = reinterpret_cast<uintptr_t>(cmd_arg.arg_bos.data());
   arg.cmd_count = 1;
   arg.arg_count = nargs;
   ioctl(dev_fd(), DRM_IOCTL_AMDXDNA_EXEC_CMD, &arg);
   cmd_arg.seq = arg.seq;
 }
 
+void
+platform_drv_host::
+submit_cmds(submit_cmds_arg& cmd_arg) const
+{
+  // Assuming 512 max args for all cmd bos
+  const size_t max_args = 512;
+  const auto nargs = cmd_arg.arg_bos.size();
+  if (nargs > max_args)
+    shim_err(EINVAL, "Max arg %ld, received %ld", max_args, nargs);
+
+  const size_t max_cmds = 256;
+  const auto ncmds = cmd_arg.cmd_bos.size();
+  if (!ncmds || ncmds > max_cmds)
+    shim_err(EINVAL, "Max cmd %ld, received %ld", max_cmds, ncmds);
+  if (ncmds > 1 && !(get_features() & AMDXDNA_FEATURE_EXEC_CMD_BATCH))
+    shim_not_supported_err("Driver does not take more than one cmd at a time");
+
+  uint32_t cmd_bo_hdls[max_cmds] = {};
+  int i = 0;
+  for (auto& id : cmd_arg.cmd_bos)
+    cmd_bo_hdls[i++] = id.handle;
+
+  amdxdna_drm_exec_cmd arg = {};
+  arg.hwctx = cmd_arg.ctx_handle;
+  arg.type = AMDXDNA_CMD_SUBMIT_EXEC_BUF;
+  if (ncmds == 1)
+    arg.cmd_handles = cmd_bo_hdls[0];
+  else
+    arg.cmd_handles = reinterpret_cast<uintptr_t>(cmd_bo_hdls);
+  arg.args = reinterpret_cast<uintptr_t>(cmd_arg.arg_bos.data());
+  arg.cmd_count = ncmds;
+  arg.arg_count = nargs;
+  // Driver leaves seq alone if nothing is submitted.
+  const uint64_t no_seq = ~0ULL;
+  arg.seq = no_seq;
+  try {
+    ioctl(dev_fd(), DRM_IOCTL_AMDXDNA_EXEC_CMD, &arg);
+  } catch (...) {
+    cmd_arg.submitted = (arg.seq == no_seq) ? 0 : arg.cmd_count;
+    cmd_arg.seq = arg.seq;
+    throw;
+  }
+  cmd_arg.submitted = arg.cmd_count;
+  cmd_arg.seq = arg.seq;
+}
+
+void
+platform_drv_host::
+submit_dependency(submit_dependency_arg& cmd_arg) const
+{
+  const auto n = cmd_arg.syncobj_handles.size();
+  if (!n || n != cmd_arg.timepoints.size())
+    shim_err(EINVAL, "Bad dependency, %ld syncobjs, %ld points", n, cmd_arg.timepoints.size());
+
+  amdxdna_drm_exec_cmd arg = {};
+  arg.hwctx = cmd_arg.ctx_handle;
+  arg.type = AMDXDNA_CMD_SUBMIT_DEPENDENCY;
+  arg.cmd_handles = reinterpret_cast<uintptr_t>(cmd_arg.syncobj_handles.data());
+  arg.args = reinterpret_cast<uintptr_t>(cmd_arg.timepoints.data());
+  arg.cmd_count = n;
+  arg.arg_count = n;
+  ioctl(dev_fd(), DRM_IOCTL_AMDXDNA_EXEC_CMD, &arg);
+  cmd_arg.seq = arg.seq;
+}
+
+void
+platform_drv_host::
+submit_signal(submit_signal_arg& cmd_arg) const
+{
+  amdxdna_drm_exec_cmd arg = {};
+  arg.hwctx = cmd_arg.ctx_handle;
+  arg.type = AMDXDNA_CMD_SUBMIT_SIGNAL;
+  arg.cmd_handles = cmd_arg.syncobj_handle;
+  arg.args = cmd_arg.timepoint;
+  arg.cmd_count = 1;
+  arg.arg_count = 1;
+  ioctl(dev_fd(), DRM_IOCTL_AMDXDNA_EXEC_CMD, &arg);
+}
+
 void
 platform_drv_host::
 wait_cmd_ioctl(wait_cmd_arg& cmd_arg) const
@@ -326,6 +401,28 @@ get_info(amdxdna_drm_get_info& info) const
   ioctl(dev_fd(), DRM_IOCTL_AMDXDNA_GET_INFO, &info);
 }
 
+uint64_t
+platform_drv_host::
+get_features() const
+{
+  std::call_once(m_features_once, [this] {
+    amdxdna_drm_query_features features = {};
+    amdxdna_drm_get_info arg = {
+      .param = DRM_AMDXDNA_QUERY_FEATURES,
+      .buffer_size = sizeof(features),
+      .buffer = reinterpret_cast<uintptr_t>(&features),
+    };
+    try {
+      get_info(arg);
+      m_features = features.flags;
+    } catch (const xrt_core::system_error& e) {
+      // Older driver does not know the query, nor any of the features.
+      shim_debug("Driver does not report features: %s", e.what());
+    }
+  });
+  return m_features;
+}
+
 void
 platform_drv_host::
 get_info_array(amdxdna_drm_get_array& info) const
@@ -5,6 +5,7 @@
 #define PLAT_HOST_H
 
 #include "../platform.h"
+#include <mutex>
 
 namespace shim_xdna {
 
@@ -47,6 +48,15 @@ private:
   void
   submit_cmd(submit_cmd_arg& arg) const override;
 
+  void
+  submit_cmds(submit_cmds_arg& arg) const override;
+
+  void
+  submit_dependency(submit_dependency_arg& arg) const override;
+
+  void
+  submit_signal(submit_signal_arg& arg) const override;
+
   void
   wait_cmd_ioctl(wait_cmd_arg& arg) const override;
 
@@ -73,6 +83,13 @@ private:
 
   void
   put_sysfs(put_sysfs_arg& arg) const override;
+
+  // AMDXDNA_FEATURE_* bits supported by driver, queried once.
+  uint64_t
+  get_features() const;
+
+  mutable std::once_flag m_features_once;
+  mutable uint64_t m_features = 0;
 };
 
 }
@@ -6,8 +6,31 @@
 #include "hwq.h"
 
 #include "core/common/query_requests.h"
+#include "core/common/config_reader.h"
 #include "core/common/api/xclbin_int.h"
 
+namespace {
+
+uint32_t
+get_wait_spin_budget_us()
+{
+  static uint32_t us =
+    xrt_core::config::detail::get_uint_value("Debug.cmd_wait_spin_us", 0);
+  return us;
+}
+
+uint32_t
+get_wait_spin_priority()
+{
+  // Contexts with this priority or higher spin, by default all of them.
+  static uint32_t prio =
+    xrt_core::config::detail::get_uint_value("Debug.cmd_wait_spin_priority",
+    AMDXDNA_QOS_LOW_PRIORITY);
+  return prio;
+}
+
+}
+
 namespace shim_xdna {
 
 //
@@ -260,11 +283,30 @@ init_qos_info(const qos_type& qos)
   }
 }
 
+uint32_t
+hwctx::
+get_wait_spin_us() const
+{
+  return m_wait_spin_us;
+}
+
+void
+hwctx::
+init_wait_spin()
+{
+  // Lower value means higher priority. Unset priority is treated as normal.
+  auto prio = m_qos.priority ? m_qos.priority : AMDXDNA_QOS_NORMAL_PRIORITY;
+  if (prio <= get_wait_spin_priority())
+    m_wait_spin_us = get_wait_spin_budget_us();
+  shim_debug("Cmd wait spin budget %dus, priority 0x%x", m_wait_spin_us, prio);
+}
+
 void
 hwctx::
 create_ctx_on_device(const qos_type& qos)
 {
   init_qos_info(qos);
+  init_wait_spin();
 
   auto [hdl, sobj, db] = m_ctx.create(m_qos, m_q->get_queue_bo(), m_ops_per_cycle, m_col_cnt);
   m_handle = hdl;
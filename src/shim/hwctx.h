@@ -97,6 +97,11 @@ public:
   uint32_t
   get_syncobj() const;
 
+  // Time budget to spin on cmd state before blocking in driver, 0 if
+  // this context always blocks.
+  uint32_t
+  get_wait_spin_us() const;
+
 private:
 
   class ctx {
@@ -122,6 +127,7 @@ private:
   uint32_t m_ops_per_cycle = 0;
   std::unique_ptr<hwq> m_q;
   amdxdna_qos_info m_qos = {};
+  uint32_t m_wait_spin_us = 0;
   // Must be the last member: destroyed first, ensuring destroy_ctx ioctl fires
   // before any other member (e.g. the UMQ BO owned by m_q) is freed.
   ctx m_ctx;
@@ -131,6 +137,9 @@ private:
 
   void
   init_qos_info(const qos_type& qos);
+
+  void
+  init_wait_spin();
 };
 
 }
@@ -3,14 +3,73 @@
 
 #include "hwq.h"
 #include "fence.h"
+#include "completion.h"
 #include "buffer.h"
 #include "shim_debug.h"
 #include "core/common/trace.h"
+#include "core/common/config_reader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <filesystem>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <x86intrin.h>
+#endif
 
 namespace {
 
+size_t
+get_pending_queue_depth()
+{
+  static const size_t depth = [] {
+    auto d = xrt_core::config::detail::get_uint_value("Debug.pending_queue_depth", 64);
+    // Ring index is masked, depth has to be power of two.
+    size_t n = 1;
+    while (n < d)
+      n <<= 1;
+    return n;
+  }();
+  return depth;
+}
+
+inline void
+cpu_relax()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Trace points cost a clock read and a record on each submission, they can
+// be turned off in xrt.ini when chasing submission rate.
+bool
+submit_trace_enabled()
+{
+  static const bool enabled =
+    xrt_core::config::detail::get_bool_value("Debug.submit_trace", true);
+  return enabled;
+}
+
+// Marshalling buffers reused by each submitting thread, so that submission
+// does not go to heap once they have grown to the largest batch seen.
+thread_local std::vector<const shim_xdna::cmd_buffer *> tls_submit_bos;
+thread_local std::vector<shim_xdna::bo_id> tls_submit_cmd_hdls;
+thread_local std::vector<uint32_t> tls_submit_arg_hdls;
+
+// Sync_file and syncobj fds are both anonymous inodes, told apart by name.
+bool
+is_sync_file(int fd)
+{
+  std::error_code ec;
+  auto link = std::filesystem::read_symlink("/proc/self/fd/" + std::to_string(fd), ec);
+  if (ec)
+    shim_err(ec.value(), "Failed to look up fence fd %d: %s", fd, ec.message());
+  return link == "anon_inode:sync_file";
+}
+
 std::string
 to_hex_string(uint64_t num) {
   std::stringstream ss;
@@ -61,7 +120,9 @@ namespace shim_xdna {
 
 hwq::
 hwq(const device& device)
-  : m_pdev(device.get_pdev())
+  : m_device(device)
+  , m_pdev(device.get_pdev())
+  , m_pending(get_pending_queue_depth())
 {
   // Pending queue processing thread should be created as the last step
   // after all other member variables have been initialized.
@@ -72,7 +133,7 @@ hwq::
 ~hwq()
 {
   {
-    std::unique_lock<std::mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> lock(m_pending_lock);
     m_pending_thread_stop = true;
   }
   m_pending_consumer_cv.notify_one();
@@ -90,9 +151,103 @@ void
 hwq::
 unbind_hwctx()
 {
+  // Ctx syncobj goes away with ctx, stop completion thread waiting on it.
+  if (m_ctx && m_use_reactor) {
+    auto syncobj = m_ctx->get_syncobj();
+    if (syncobj != AMDXDNA_INVALID_FENCE_HANDLE)
+      m_pdev.get_completion_reactor().remove(syncobj);
+  }
   m_ctx = nullptr;
 }
 
+void
+hwq::
+notify_on_completion(xrt_core::buffer_handle *cmd, std::function<void(int)> cb)
+{
+  if (poll_command(cmd)) {
+    cb(0);
+    return;
+  }
+
+  if (m_ctx->get_syncobj() == AMDXDNA_INVALID_FENCE_HANDLE)
+    shim_not_supported_err(__func__);
+
+  auto boh = static_cast<cmd_buffer*>(cmd);
+  auto seq = boh->wait_for_submitted();
+  add_completion_waiter(seq, [this, cmd, cb = std::move(cb)](int err) {
+    // Give subclass a chance to update cmd state, e.g. UMQ.
+    if (!err)
+      poll_command(cmd);
+    cb(err);
+  });
+}
+
+bool
+hwq::
+add_completion_waiter(uint64_t seq, std::function<void(int)> cb)
+{
+  auto syncobj = m_ctx->get_syncobj();
+  if (syncobj == AMDXDNA_INVALID_FENCE_HANDLE)
+    return false;
+
+  m_use_reactor = true;
+  m_pdev.get_completion_reactor().add(syncobj, seq, std::move(cb));
+  return true;
+}
+
+std::future<void>
+hwq::
+get_completion_future(xrt_core::buffer_handle *cmd)
+{
+  auto p = std::make_shared<std::promise<void>>();
+  auto f = p->get_future();
+  notify_on_completion(cmd, [p](int err) {
+    if (!err) {
+      p->set_value();
+      return;
+    }
+    try {
+      shim_err(err, "Waiting for command completion failed");
+    } catch (...) {
+      p->set_exception(std::current_exception());
+    }
+  });
+  return f;
+}
+
+int
+hwq::
+export_sync_file(xrt_core::buffer_handle *cmd) const
+{
+  auto syncobj = m_ctx->get_syncobj();
+  if (syncobj == AMDXDNA_INVALID_FENCE_HANDLE)
+    shim_not_supported_err(__func__);
+
+  auto boh = static_cast<cmd_buffer*>(cmd);
+  sync_file_arg arg = {
+    .handle = syncobj,
+    .timepoint = boh->wait_for_submitted(),
+    .fd = -1,
+  };
+  m_pdev.drv_ioctl(drv_ioctl_cmd::export_sync_file, &arg);
+  shim_debug("Exported BO %d@%ld as sync_file %d", boh->id().handle, arg.timepoint, arg.fd);
+  return arg.fd;
+}
+
+std::unique_ptr<xrt_core::fence_handle>
+hwq::
+import(xrt_core::fence_handle::export_handle ehdl)
+{
+  if (is_sync_file(ehdl))
+    return fence::import_sync_file(m_device, ehdl);
+
+  // Imported fence owns and closes its fd, keep caller's.
+  auto fd = dup(ehdl);
+  if (fd < 0)
+    shim_err(-errno, "Failed to dup fence fd %d", ehdl);
+  return std::make_unique<fence>(m_device, fd);
+}
+
 int
 hwq::
 poll_command(xrt_core::buffer_handle *cmd) const
@@ -138,6 +293,104 @@ wait_command(uint64_t seq, uint32_t timeout_ms) const
   return ret;
 }
 
+int
+hwq::
+wait_commands(const std::vector<queued_cmd>& cmds, uint32_t timeout_ms, bool wait_all)
+{
+  if (cmds.empty())
+    shim_err(EINVAL, "No command to wait on");
+
+  // Skip driver if it is already decided by cmd state.
+  std::vector<size_t> idx;
+  for (size_t i = 0; i < cmds.size(); i++) {
+    if (!cmds[i].first->poll_command(cmds[i].second))
+      idx.push_back(i);
+    else if (!wait_all)
+      return static_cast<int>(i);
+  }
+  if (idx.empty())
+    return 0;
+
+  auto& dev = cmds.front().first->m_pdev;
+  std::vector<uint32_t> handles;
+  std::vector<uint64_t> points;
+  handles.reserve(idx.size());
+  points.reserve(idx.size());
+  for (auto i : idx) {
+    auto q = cmds[i].first;
+    auto syncobj = q->m_ctx->get_syncobj();
+    if (&q->m_pdev != &dev)
+      shim_err(EINVAL, "Can't wait on commands from different devices");
+    if (syncobj == AMDXDNA_INVALID_FENCE_HANDLE)
+      shim_not_supported_err(__func__);
+    handles.push_back(syncobj);
+    points.push_back(static_cast<cmd_buffer*>(cmds[i].second)->wait_for_submitted());
+  }
+
+  wait_syncobjs_arg warg = {
+    .handles = handles,
+    .timepoints = points,
+    .timeout_ms = timeout_ms,
+    .wait_all = wait_all,
+    .first_signaled = 0,
+  };
+  try {
+    dev.drv_ioctl(drv_ioctl_cmd::wait_syncobjs, &warg);
+  } catch (const xrt_core::system_error& ex) {
+    if (std::abs(ex.get_code()) != ETIME)
+      throw;
+    return -1;
+  }
+
+  // Give queue a chance to update cmd state, e.g. UMQ.
+  if (wait_all) {
+    for (auto i : idx)
+      cmds[i].first->poll_command(cmds[i].second);
+    return 0;
+  }
+  auto i = idx[warg.first_signaled];
+  cmds[i].first->poll_command(cmds[i].second);
+  return static_cast<int>(i);
+}
+
+int
+hwq::
+wait_any_command(const std::vector<queued_cmd>& cmds, uint32_t timeout_ms)
+{
+  return wait_commands(cmds, timeout_ms, false);
+}
+
+int
+hwq::
+wait_all_commands(const std::vector<queued_cmd>& cmds, uint32_t timeout_ms)
+{
+  return wait_commands(cmds, timeout_ms, true) >= 0 ? 1 : 0;
+}
+
+uint32_t
+hwq::
+spin_on_command(xrt_core::buffer_handle *cmd, uint32_t budget_us) const
+{
+  using clock = std::chrono::steady_clock;
+  // Max number of pause between two polls of cmd state.
+  constexpr uint32_t max_backoff = 64;
+
+  auto start = clock::now();
+  auto deadline = start + std::chrono::microseconds(budget_us);
+  uint32_t backoff = 1;
+
+  while (clock::now() < deadline) {
+    for (uint32_t i = 0; i < backoff; i++)
+      cpu_relax();
+    if (poll_command(cmd))
+      break;
+    if (backoff < max_backoff)
+      backoff <<= 1;
+  }
+  auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+  return static_cast<uint32_t>(spent.count());
+}
+
 int
 hwq::
 wait_command(xrt_core::buffer_handle *cmd, uint32_t timeout_ms) const
@@ -149,26 +402,51 @@ wait_command(xrt_core::buffer_handle *cmd, uint32_t timeout_ms) const
   auto boh = static_cast<cmd_buffer*>(cmd);
   auto seq = boh->wait_for_submitted();
 
+  // Short running cmd may be done before we could be woken up by driver.
+  // Spin on cmd state for a while before blocking in driver.
+  auto budget_us = m_ctx->get_wait_spin_us();
+  if (budget_us) {
+    if (timeout_ms)
+      budget_us = std::min<uint64_t>(budget_us, timeout_ms * 1000ULL);
+    auto spent_ms = spin_on_command(cmd, budget_us);
+    if (poll_command(cmd))
+      return 1;
+    if (timeout_ms) {
+      if (spent_ms >= timeout_ms)
+        return 0;
+      timeout_ms -= spent_ms;
+    }
+  }
+
   shim_debug("Waiting for BO %d@%ld...", boh->id().handle, seq);
   return wait_command(seq, timeout_ms);
 }
 
 void
 hwq::
-push_to_pending_queue(std::unique_lock<std::mutex>& lock,
-  const void *cmd, uint64_t fence_state, pending_cmd_type type)
+push_to_pending_queue(const void *cmd, uint64_t fence_state, pending_cmd_type type)
 {
+  // Caller holds m_mutex, so there is only one producer at a time.
   if (m_pending_thread_stop)
     shim_err(EINVAL, "Enqueuing when processing thread is stopped");
 
-  m_pending_producer_cv.wait(lock, [this]() { return !pending_queue_full(); });
-  pending_cmd& c = m_pending[pending_queue_producer_idx()];
+  if (pending_queue_full()) {
+    std::unique_lock<std::mutex> lock(m_pending_lock);
+    m_pending_producer_cv.wait(lock, [this]() { return !pending_queue_full(); });
+  }
+
+  auto prod = m_pending_producer.load(std::memory_order_relaxed);
+  pending_cmd& c = m_pending[prod & (m_pending.size() - 1)];
   c.m_type = type;
   c.m_cmd = cmd;
   c.m_fence_state = fence_state;
-  c.m_last_seq = m_last_seq;
-  m_pending_producer++;
-  m_pending_consumer_cv.notify_one();
+  m_pending_producer.store(prod + 1);
+
+  // Only wake up consumer when it may have seen an empty queue.
+  if (m_pending_consumer.load() == prod) {
+    { std::lock_guard<std::mutex> lock(m_pending_lock); }
+    m_pending_consumer_cv.notify_one();
+  }
 }
 
 void
@@ -177,121 +455,179 @@ submit_command(xrt_core::buffer_handle *cmd)
 {
   auto boh = static_cast<cmd_buffer*>(cmd);
 
-  XRT_TRACE_POINT_SCOPE1(submit_command, boh->id().handle);
-  std::unique_lock<std::mutex> lock(m_mutex);
+  if (submit_trace_enabled()) {
+    XRT_TRACE_POINT_SCOPE1(submit_command, boh->id().handle);
+    enqueue_command(boh);
+    return;
+  }
+  enqueue_command(boh);
+}
+
+void
+hwq::
+enqueue_command(cmd_buffer *boh)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
 
   dump_arg_bos(boh);
 
   // If pending queue is empty, submit directly to driver, else enqueue.
   if (pending_queue_empty()) {
     auto seq = issue_command(boh);
+    m_last_seq = seq;
     boh->mark_submitted(seq);
   } else {
-    shim_debug("Enqueuing command after command %ld", m_last_seq);
-    push_to_pending_queue(lock, boh, 0, pending_cmd_type::io);
+    shim_debug("Enqueuing command after command %ld", m_last_seq.load());
+    // Mark before enqueuing, pending thread may submit it right away.
     boh->mark_enqueued();
+    push_to_pending_queue(boh, 0, pending_cmd_type::io);
   }
 }
 
 void
 hwq::
-submit_wait(const xrt_core::fence_handle* f)
+submit_commands(const std::vector<xrt_core::buffer_handle *>& cmds)
 {
-  std::unique_lock<std::mutex> lock(m_mutex);
-  auto fh = static_cast<const fence*>(f);
-  shim_debug("Enqueuing wait fence %s after command %ld", fh->describe().c_str(), m_last_seq);
-  push_to_pending_queue(lock, fh, fh->next_wait_state(), pending_cmd_type::wait);
+  if (cmds.empty())
+    return;
+
+  auto& bos = tls_submit_bos;
+  bos.clear();
+  for (auto cmd : cmds)
+    bos.push_back(static_cast<cmd_buffer*>(cmd));
+
+  if (submit_trace_enabled()) {
+    XRT_TRACE_POINT_SCOPE1(submit_command, bos.front()->id().handle);
+    enqueue_commands(bos);
+    return;
+  }
+  enqueue_commands(bos);
 }
 
 void
 hwq::
-submit_signal(const xrt_core::fence_handle* f)
+enqueue_commands(const std::vector<const cmd_buffer *>& bos)
 {
-  std::unique_lock<std::mutex> lock(m_mutex);
-  auto fh = static_cast<const fence*>(f);
-  shim_debug("Enqueuing signal fence %s after command %ld", fh->describe().c_str(), m_last_seq);
-  push_to_pending_queue(lock, fh, fh->next_signal_state(), pending_cmd_type::signal);
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (auto boh : bos)
+    dump_arg_bos(boh);
+
+  // Same rule as single cmd, only go to driver directly when nothing is
+  // pending, otherwise cmds are queued one by one to keep the order.
+  if (pending_queue_empty()) {
+    issue_commands(bos);
+    return;
+  }
+
+  shim_debug("Enqueuing %ld commands after command %ld", bos.size(), m_last_seq.load());
+  for (auto boh : bos) {
+    boh->mark_enqueued();
+    push_to_pending_queue(boh, 0, pending_cmd_type::io);
+  }
 }
 
-bool
+void
 hwq::
-pending_queue_empty() const
+submit_wait(const xrt_core::fence_handle* f)
 {
-  return m_pending_consumer == m_pending_producer;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto fh = static_cast<const fence*>(f);
+  auto state = fh->next_wait_state();
+  // Driver holds back cmds submitted after the wait, no need to block here.
+  if (pending_queue_empty() && issue_fence(fh, state, pending_cmd_type::wait))
+    return;
+#ifdef XDNA_SHIM_DEBUG
+  shim_debug("Enqueuing wait fence %s after command %ld", fh->describe().c_str(), m_last_seq.load());
+#endif
+  push_to_pending_queue(fh, state, pending_cmd_type::wait);
 }
 
-bool
+void
 hwq::
-pending_queue_full() const
+submit_signal(const xrt_core::fence_handle* f)
 {
-  return (m_pending_producer - m_pending_consumer) == m_pending.size();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto fh = static_cast<const fence*>(f);
+  auto state = fh->next_signal_state();
+  // Driver signals the fence once last submitted cmd is done.
+  if (pending_queue_empty() && issue_fence(fh, state, pending_cmd_type::signal))
+    return;
+#ifdef XDNA_SHIM_DEBUG
+  shim_debug("Enqueuing signal fence %s after command %ld", fh->describe().c_str(), m_last_seq.load());
+#endif
+  push_to_pending_queue(fh, state, pending_cmd_type::signal);
 }
 
-uint64_t
+bool
 hwq::
-pending_queue_consumer_idx() const
+pending_queue_empty() const
 {
-  return (m_pending_consumer & (m_pending.size() - 1));
+  return m_pending_consumer.load() == m_pending_producer.load();
 }
 
-uint64_t
+bool
 hwq::
-pending_queue_producer_idx() const
+pending_queue_full() const
 {
-  return (m_pending_producer & (m_pending.size() - 1));
+  return (m_pending_producer.load() - m_pending_consumer.load()) == m_pending.size();
 }
 
 void
 hwq::
 process_pending_queue()
 {
-  uint64_t seq = 0;
   shim_debug("Pending queue thread started!");
 
-  std::unique_lock<std::mutex> lock(m_mutex);
-
-  while (!(m_pending_thread_stop && pending_queue_empty())) {
-
+  while (true) {
     // Wait for new pending commands or quit indicator.
-    m_pending_consumer_cv.wait(lock,
-      [this]() { return m_pending_thread_stop || !pending_queue_empty(); });
-
-    // Process all pending commands in queued order.
-    if (!pending_queue_empty()) {
-      // Releasing the lock, allow others to add to the pending queue while
-      // it is being processed. The pending cmd is processed in this single
-      // thread, so no need for any locking.
-      lock.unlock();
-
-      pending_cmd& c = m_pending[pending_queue_consumer_idx()];
-      switch (c.m_type) {
-      case pending_cmd_type::io: {
-        auto boh = reinterpret_cast<const cmd_buffer*>(c.m_cmd);
-        seq = issue_command(boh);
-        boh->mark_submitted(seq);
-        break;
-      }
-      case pending_cmd_type::signal: {
-        auto fh = reinterpret_cast<const fence*>(c.m_cmd);
-        if (c.m_last_seq != INVALID_SEQ)
-          wait_command(c.m_last_seq, 0);
-        fh->signal(c.m_fence_state);
-        break;
-      }
-      case pending_cmd_type::wait: {
-        auto fh = reinterpret_cast<const fence*>(c.m_cmd);
-        fh->wait(c.m_fence_state);
+    if (pending_queue_empty()) {
+      std::unique_lock<std::mutex> lock(m_pending_lock);
+      m_pending_consumer_cv.wait(lock,
+        [this]() { return m_pending_thread_stop || !pending_queue_empty(); });
+      if (pending_queue_empty())
+        break; // Stopped and nothing left to process.
+    }
+
+    // Process pending commands in queued order. The slot is owned by this
+    // thread until consumer index moves past it, no locking is needed.
+    auto cons = m_pending_consumer.load(std::memory_order_relaxed);
+    pending_cmd& c = m_pending[cons & (m_pending.size() - 1)];
+    switch (c.m_type) {
+    case pending_cmd_type::io: {
+      auto boh = reinterpret_cast<const cmd_buffer*>(c.m_cmd);
+      auto seq = issue_command(boh);
+      m_last_seq = seq;
+      boh->mark_submitted(seq);
+      break;
+    }
+    case pending_cmd_type::signal: {
+      auto fh = reinterpret_cast<const fence*>(c.m_cmd);
+      // All cmds queued before this signal have been sent to driver by now.
+      if (issue_fence(fh, c.m_fence_state, c.m_type))
         break;
-      }
-      default:
-        shim_err(EINVAL, "Bad pending cmd!");
+      auto last_seq = m_last_seq.load();
+      if (last_seq != INVALID_SEQ)
+        wait_command(last_seq, 0);
+      fh->signal(c.m_fence_state);
+      break;
+    }
+    case pending_cmd_type::wait: {
+      auto fh = reinterpret_cast<const fence*>(c.m_cmd);
+      if (issue_fence(fh, c.m_fence_state, c.m_type))
         break;
-      }
+      fh->wait(c.m_fence_state);
+      break;
+    }
+    default:
+      shim_err(EINVAL, "Bad pending cmd!");
+      break;
+    }
 
-      lock.lock();
-      if (c.m_type == pending_cmd_type::io)
-        m_last_seq = seq;
-      m_pending_consumer++;
+    m_pending_consumer.store(cons + 1);
+    // Only wake up producer when it may have seen a full queue.
+    if (m_pending_producer.load() - cons == m_pending.size()) {
+      { std::lock_guard<std::mutex> lock(m_pending_lock); }
       m_pending_producer_cv.notify_all();
     }
   }
@@ -299,14 +635,128 @@ process_pending_queue()
   shim_debug("Pending queue thread stopped!");
 }
 
+void
+hwq::
+issue_commands(const std::vector<const cmd_buffer *>& cmds)
+{
+  // Caller holds m_mutex.
+  if (cmds.size() > 1 && m_batch_submit && can_batch_submit()) {
+    auto& cmd_bos = tls_submit_cmd_hdls;
+    auto& arg_bos = tls_submit_arg_hdls;
+    cmd_bos.clear();
+    arg_bos.clear();
+    for (auto boh : cmds) {
+      cmd_bos.push_back(boh->id());
+      auto hdls = boh->get_arg_bo_handles();
+      arg_bos.insert(arg_bos.end(), hdls->begin(), hdls->end());
+    }
+    std::sort(arg_bos.begin(), arg_bos.end());
+    arg_bos.erase(std::unique(arg_bos.begin(), arg_bos.end()), arg_bos.end());
+
+    submit_cmds_arg ecmd = {
+      .ctx_handle = m_ctx->get_slotidx(),
+      .cmd_bos = cmd_bos,
+      .arg_bos = arg_bos,
+      .seq = 0,
+      .submitted = 0,
+    };
+    auto mark_batch = [&ecmd, &cmds, this]() {
+      // Submitters on this queue are serialized, driver hands out seq
+      // back to back for cmds in one batch.
+      for (size_t i = 0; i < ecmd.submitted; i++)
+        cmds[i]->mark_submitted(ecmd.seq - (ecmd.submitted - 1 - i));
+      if (ecmd.submitted)
+        m_last_seq = ecmd.seq;
+    };
+
+    try {
+      m_pdev.drv_ioctl(drv_ioctl_cmd::submit_cmds, &ecmd);
+      mark_batch();
+      shim_debug("Submitted %ld BOs, last @%ld", ecmd.submitted, ecmd.seq);
+      return;
+    } catch (const xrt_core::system_error& ex) {
+      if (ecmd.submitted) {
+        mark_batch();
+        throw;
+      }
+      // Nothing is submitted. Platform or driver may not take more than
+      // one cmd at a time, stop trying and submit one by one from now on.
+      // Any other error is about the cmds themselves.
+      if (std::abs(ex.get_code()) != ENOTSUP)
+        throw;
+      shim_debug("Batched submission is not supported, falling back");
+      m_batch_submit = false;
+    }
+  }
+
+  for (auto boh : cmds) {
+    auto seq = issue_command(boh);
+    m_last_seq = seq;
+    boh->mark_submitted(seq);
+  }
+}
+
+bool
+hwq::
+issue_fence(const fence *fh, uint64_t state, pending_cmd_type type)
+{
+  // Caller holds m_mutex with an empty pending queue, or is the pending
+  // queue thread, so nothing else is submitting to driver.
+  if (!m_driver_fence || !can_submit_fence())
+    return false;
+
+  try {
+    if (type == pending_cmd_type::signal) {
+      submit_signal_arg sarg = {
+        .ctx_handle = m_ctx->get_slotidx(),
+        .syncobj_handle = fh->get_syncobj(),
+        .timepoint = state,
+      };
+      m_pdev.drv_ioctl(drv_ioctl_cmd::submit_signal, &sarg);
+      shim_debug("Submitted signal fence %d@%ld after command %ld",
+        sarg.syncobj_handle, state, m_last_seq.load());
+      return true;
+    }
+
+    const std::vector<uint32_t> hdls{ fh->get_syncobj() };
+    const std::vector<uint64_t> points{ state };
+    submit_dependency_arg darg = {
+      .ctx_handle = m_ctx->get_slotidx(),
+      .syncobj_handles = hdls,
+      .timepoints = points,
+      .seq = 0,
+    };
+    m_pdev.drv_ioctl(drv_ioctl_cmd::submit_dependency, &darg);
+    // The no-op cmd is now the last one, later signal waits for it as well.
+    m_last_seq = darg.seq;
+    shim_debug("Submitted wait fence %d@%ld as command %ld", hdls[0], state, darg.seq);
+    return true;
+  } catch (const xrt_core::system_error& ex) {
+    auto err = std::abs(ex.get_code());
+    // Driver can't wait on a point which is not submitted yet, e.g. fence
+    // to be signaled on host later. Only this one is done on host.
+    if (err == EINVAL) {
+      shim_debug("Driver turned down fence %d@%ld, falling back", fh->get_syncobj(), state);
+      return false;
+    }
+    if (err != ENOTSUP)
+      throw;
+    // Platform or driver can't do it, wait/signal on host from now on.
+    shim_debug("Fence submission is not supported, falling back");
+    m_driver_fence = false;
+  }
+  return false;
+}
+
 uint64_t
 hwq::
 issue_command(const cmd_buffer *cmd_bo)
 {
+  auto arg_bos = cmd_bo->get_arg_bo_handles();
   submit_cmd_arg ecmd = {
     .ctx_handle = m_ctx->get_slotidx(),
     .cmd_bo = cmd_bo->id(),
-    .arg_bos = cmd_bo->get_arg_bo_ids(),
+    .arg_bos = *arg_bos,
   };
   m_pdev.drv_ioctl(drv_ioctl_cmd::submit_cmd, &ecmd);
   shim_debug("Submitted BO %d@%ld", cmd_bo->id().handle, ecmd.seq);
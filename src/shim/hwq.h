@@ -8,7 +8,12 @@
 #include "hwctx.h"
 #include "buffer.h"
 #include "core/common/shim/hwqueue_handle.h"
+#include <atomic>
+#include <functional>
+#include <future>
 #include <thread>
+#include <utility>
+#include <vector>
 
 namespace shim_xdna {
 
@@ -33,9 +38,11 @@ public:
   void
   submit_signal(const xrt_core::fence_handle*) override;
 
+  // Import fence fd as a fence which can be waited on by submit_wait(). Fd
+  // is either a sync_file or a syncobj shared by fence share(). Caller still
+  // owns fd.
   std::unique_ptr<xrt_core::fence_handle>
-  import(xrt_core::fence_handle::export_handle) override
-  { shim_not_supported_err(__func__); }
+  import(xrt_core::fence_handle::export_handle) override;
 
 public:
   virtual void
@@ -50,16 +57,69 @@ public:
   virtual void
   dump() const {}
 
+  // Submit a batch of cmds in one driver call when possible. Cmds are
+  // executed in the order they appear in the batch.
+  void
+  submit_commands(const std::vector<xrt_core::buffer_handle *>& cmds);
+
+  // Completion driven alternative to wait_command(). The device completion
+  // thread calls cb with 0 once cmd is done, or with an error code if the
+  // wait is cancelled or failed.
+  void
+  notify_on_completion(xrt_core::buffer_handle *cmd, std::function<void(int)> cb);
+
+  std::future<void>
+  get_completion_future(xrt_core::buffer_handle *cmd);
+
+  // Export completion of cmd as sync_file fd, owned by caller. Not part of
+  // XRT hw queue interface, callers reach it by casting the queue handle.
+  int
+  export_sync_file(xrt_core::buffer_handle *cmd) const;
+
+  // Cmd submitted to a queue, for waiting on cmds across queues.
+  using queued_cmd = std::pair<const hwq*, xrt_core::buffer_handle*>;
+
+  // Wait for the first of cmds to complete in one driver call. Returns its
+  // index, or -1 on timeout. Timeout of 0 means waiting forever.
+  static int
+  wait_any_command(const std::vector<queued_cmd>& cmds, uint32_t timeout_ms);
+
+  // Wait for all cmds to complete in one driver call. Returns 1 when all
+  // are done, or 0 on timeout.
+  static int
+  wait_all_commands(const std::vector<queued_cmd>& cmds, uint32_t timeout_ms);
+
 protected:
+  const device& m_device;
   const pdev& m_pdev;
   const hwctx* m_ctx = nullptr;
 
   int
   wait_command(uint64_t seq, uint32_t timeout_ms) const;
 
+  // Busy poll cmd state with backoff until it is completed or up to
+  // budget_us. Returns time spent in ms.
+  uint32_t
+  spin_on_command(xrt_core::buffer_handle *cmd, uint32_t budget_us) const;
+
   virtual uint64_t
   issue_command(const cmd_buffer *);
 
+  virtual bool
+  can_batch_submit() const
+  { return true; }
+
+  // Whether driver scheduler orders cmds on this queue, so that fence
+  // wait/signal can be submitted to driver along with cmds.
+  virtual bool
+  can_submit_fence() const
+  { return true; }
+
+  // Have device completion thread call cb once seq is completed. Returns
+  // false if this queue can't be waited on that way.
+  bool
+  add_completion_waiter(uint64_t seq, std::function<void(int)> cb);
+
 private:
   enum class pending_cmd_type
   {
@@ -71,38 +131,63 @@ private:
     pending_cmd_type m_type;
     const void* m_cmd = nullptr;
     uint64_t m_fence_state;
-    uint64_t m_last_seq;
   };
 
+  // Returns index of first completed cmd, or -1 on timeout.
+  static int
+  wait_commands(const std::vector<queued_cmd>& cmds, uint32_t timeout_ms, bool wait_all);
+
   bool
   pending_queue_empty() const;
 
   bool
   pending_queue_full() const;
 
-  uint64_t
-  pending_queue_consumer_idx() const;
+  void
+  process_pending_queue();
+
+  void
+  push_to_pending_queue(const void *cmd, uint64_t fence_state, pending_cmd_type type);
 
-  uint64_t
-  pending_queue_producer_idx() const;
+  void
+  issue_commands(const std::vector<const cmd_buffer *>& cmds);
 
+  // Submit to driver or pending queue, caller is not holding m_mutex.
   void
-  process_pending_queue();
+  enqueue_command(cmd_buffer *boh);
 
   void
-  push_to_pending_queue(std::unique_lock<std::mutex>& lock,
-    const void *cmd, uint64_t fence_state, pending_cmd_type type);
+  enqueue_commands(const std::vector<const cmd_buffer *>& bos);
 
-  std::mutex m_mutex;
-  const uint64_t INVALID_SEQ = 0xffffffffffffffff;
-  uint64_t m_last_seq = INVALID_SEQ;
+  // Hand fence wait/signal over to driver. Returns false if driver can't
+  // take it and caller has to wait/signal on host instead.
+  bool
+  issue_fence(const fence *fh, uint64_t state, pending_cmd_type type);
 
-  bool m_pending_thread_stop = false;
-  std::array<pending_cmd, 1> m_pending;
+  // Serializing submitters. The pending queue consumer never takes it.
+  std::mutex m_mutex;
+  static constexpr uint64_t INVALID_SEQ = 0xffffffffffffffff;
+  // Seq of last cmd sent to driver, by submitter or by pending queue thread.
+  std::atomic<uint64_t> m_last_seq{INVALID_SEQ};
+  // Cleared once driver turns down a batched submission, protected by m_mutex.
+  bool m_batch_submit = true;
+  // Cleared once driver turns down a fence wait/signal submission.
+  std::atomic<bool> m_driver_fence{true};
+  // Set once any cmd on this queue is handed to device completion thread.
+  std::atomic<bool> m_use_reactor{false};
+
+  // Single consumer ring of pending commands. Producers are serialized by
+  // m_mutex and only publish m_pending_producer. The pending thread is the
+  // only one advancing m_pending_consumer. m_pending_lock is taken only to
+  // park/wake the consumer on empty->non-empty transition or a producer on
+  // full->non-full transition.
+  std::atomic<bool> m_pending_thread_stop{false};
+  std::vector<pending_cmd> m_pending;
+  std::mutex m_pending_lock;
   std::condition_variable m_pending_producer_cv;
   std::condition_variable m_pending_consumer_cv;
-  uint64_t m_pending_consumer = 0;
-  uint64_t m_pending_producer = 0;
+  std::atomic<uint64_t> m_pending_consumer{0};
+  std::atomic<uint64_t> m_pending_producer{0};
   std::thread m_pending_thread;
 };
 
@@ -19,6 +19,16 @@ get_heap_num_pages()
   return num;
 }
 
+// Start growing heap in background once DEV BOs reach this percentage of
+// current heap size, 0 disables it.
+unsigned int
+get_heap_expand_watermark()
+{
+  static unsigned int pct =
+    xrt_core::config::detail::get_uint_value("Debug.heap_expand_watermark", 75);
+  return pct;
+}
+
 }
 
 namespace shim_xdna {
@@ -62,6 +72,13 @@ get_heap_vaddr() const
   return m_dev_heap_bo->vaddr();
 }
 
+const buffer *
+pdev_kmq::
+get_heap_bo() const
+{
+  return m_dev_heap_bo.get();
+}
+
 bool
 pdev_kmq::
 is_umq() const
@@ -90,13 +107,19 @@ create_drm_bo(bo_info *arg) const
   for (;;) {
     try {
       drv_ioctl(drv_ioctl_cmd::create_bo, arg);
-      return;
+      break;
     } catch (const xrt_core::system_error& ex) {
       if (ex.get_code() != EAGAIN)
         throw;
       m_dev_heap_bo->expand(heap_page_size);
     }
   }
+
+  // Grow heap ahead of time so that next allocations do not stall on it.
+  auto pct = get_heap_expand_watermark();
+  auto used = arg->xdna_addr + arg->size - m_dev_heap_bo->paddr();
+  if (pct && used * 100 >= m_dev_heap_bo->size() * pct)
+    m_dev_heap_bo->expand_async(heap_page_size);
 }
 
 } // namespace shim_xdna
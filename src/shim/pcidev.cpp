@@ -3,9 +3,52 @@
 
 #include "device.h"
 #include "pcidev.h"
+#include "completion.h"
+#include "bo_pool.h"
 #include "pcidrv.h"
 #include "shim_debug.h"
 #include "core/common/trace.h"
+#include "core/common/config_reader.h"
+
+namespace {
+
+// Total size of freed BOs kept for reuse, 0 disables BO pool.
+size_t
+get_bo_pool_size()
+{
+  static size_t mb =
+    xrt_core::config::detail::get_uint_value("Debug.bo_pool_size_mb", 0);
+  return mb * 1024 * 1024;
+}
+
+// BOs larger than this are never pooled.
+size_t
+get_bo_pool_max_bo_size()
+{
+  static size_t kb =
+    xrt_core::config::detail::get_uint_value("Debug.bo_pool_max_bo_kb", 4096);
+  return kb * 1024;
+}
+
+// SHARE BOs no larger than this are sub-allocated from slabs, 0 disables it.
+// Sub-allocated BO can't be exported since it shares DRM BO with others.
+size_t
+get_slab_max_bo_size()
+{
+  static size_t sz =
+    xrt_core::config::detail::get_uint_value("Debug.bo_slab_max_size", 0);
+  return sz;
+}
+
+size_t
+get_slab_size()
+{
+  static size_t kb =
+    xrt_core::config::detail::get_uint_value("Debug.bo_slab_size_kb", 256);
+  return kb * 1024;
+}
+
+}
 
 namespace shim_xdna {
 
@@ -46,6 +89,15 @@ open() const
       m_driver->drv_close();
       throw;
     }
+    {
+      std::lock_guard<std::mutex> lg(m_bo_pool_lock);
+      if (get_bo_pool_size())
+        m_bo_pool = std::make_shared<bo_pool>(get_bo_pool_size(), get_bo_pool_max_bo_size());
+      if (get_slab_max_bo_size() && get_slab_size()) {
+        m_slab_alloc = std::make_shared<slab_allocator>(*this, AMDXDNA_BO_SHARE,
+          get_slab_size(), get_slab_max_bo_size());
+      }
+    }
   }
   ++m_dev_users;
 }
@@ -58,6 +110,20 @@ close() const
 
   --m_dev_users;
   if (m_dev_users == 0) {
+    {
+      std::lock_guard<std::mutex> lg(m_reactor_lock);
+      m_reactor.reset();
+    }
+    {
+      // BOs still alive will be freed instead of cached from now on.
+      std::lock_guard<std::mutex> lg(m_bo_pool_lock);
+      if (m_bo_pool)
+        m_bo_pool->shutdown();
+      m_bo_pool.reset();
+      if (m_slab_alloc)
+        m_slab_alloc->shutdown();
+      m_slab_alloc.reset();
+    }
     try {
       on_last_close();
       m_driver->drv_close();
@@ -81,6 +147,32 @@ munmap(void* addr, size_t len) const
   m_driver->drv_munmap(addr, len);
 }
 
+completion_reactor&
+pdev::
+get_completion_reactor() const
+{
+  std::lock_guard<std::mutex> lg(m_reactor_lock);
+  if (!m_reactor)
+    m_reactor = std::make_unique<completion_reactor>(*this);
+  return *m_reactor;
+}
+
+std::shared_ptr<bo_pool>
+pdev::
+get_bo_pool() const
+{
+  std::lock_guard<std::mutex> lg(m_bo_pool_lock);
+  return m_bo_pool;
+}
+
+std::shared_ptr<slab_allocator>
+pdev::
+get_slab_allocator() const
+{
+  std::lock_guard<std::mutex> lg(m_bo_pool_lock);
+  return m_slab_alloc;
+}
+
 void
 pdev::
 drv_ioctl(drv_ioctl_cmd cmd, void* arg) const
@@ -225,27 +317,89 @@ void
 pdev::
 insert_bo_handle(uint64_t handle, xrt_core::buffer_handle *ptr) const
 {
-  std::unique_lock<std::shared_mutex> lock(m_bo_map_lock);
-  m_bo_map[handle] = ptr;
+  m_bo_map.insert(handle, ptr);
 }
 
 void
 pdev::
 remove_bo_handle(uint64_t handle) const
 {
-  std::unique_lock<std::shared_mutex> lock(m_bo_map_lock);
-  m_bo_map.erase(handle);
+  m_bo_map.remove(handle);
 }
 
 xrt_core::buffer_handle *
 pdev::
 find_bo_by_handle(uint64_t handle) const
 {
-  std::shared_lock<std::shared_mutex> lock(m_bo_map_lock);
-  auto it = m_bo_map.find(handle);
-  if (it == m_bo_map.end())
+  auto bo = m_bo_map.find(handle);
+  if (!bo)
     shim_err(EINVAL, "BO handle %d is not found in BO map", handle);
-  return m_bo_map[handle];
+  return bo;
+}
+
+//
+// Impl for class bo_handle_table
+//
+
+bo_handle_table::
+~bo_handle_table()
+{
+  for (auto& p : m_pages)
+    delete p.load(std::memory_order_relaxed);
+}
+
+void
+bo_handle_table::
+insert(uint64_t handle, xrt_core::buffer_handle *ptr)
+{
+  auto idx = handle >> page_shift;
+  if (idx >= max_pages) {
+    std::unique_lock<std::shared_mutex> lock(m_overflow_lock);
+    m_overflow[handle] = ptr;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_update_lock);
+  auto p = m_pages[idx].load(std::memory_order_relaxed);
+  if (!p) {
+    p = new page(); // Value initialized to all nullptr
+    m_pages[idx].store(p, std::memory_order_release);
+  }
+  (*p)[handle & (page_entries - 1)].store(ptr, std::memory_order_release);
+}
+
+void
+bo_handle_table::
+remove(uint64_t handle)
+{
+  auto idx = handle >> page_shift;
+  if (idx >= max_pages) {
+    std::unique_lock<std::shared_mutex> lock(m_overflow_lock);
+    m_overflow.erase(handle);
+    return;
+  }
+
+  // Pages are never freed till table is gone, so no lock is needed.
+  auto p = m_pages[idx].load(std::memory_order_acquire);
+  if (p)
+    (*p)[handle & (page_entries - 1)].store(nullptr, std::memory_order_release);
+}
+
+xrt_core::buffer_handle *
+bo_handle_table::
+find(uint64_t handle) const
+{
+  auto idx = handle >> page_shift;
+  if (idx >= max_pages) {
+    std::shared_lock<std::shared_mutex> lock(m_overflow_lock);
+    auto it = m_overflow.find(handle);
+    return it == m_overflow.end() ? nullptr : it->second;
+  }
+
+  auto p = m_pages[idx].load(std::memory_order_acquire);
+  if (!p)
+    return nullptr;
+  return (*p)[handle & (page_entries - 1)].load(std::memory_order_acquire);
 }
 
 }
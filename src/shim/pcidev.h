@@ -6,10 +6,50 @@
 
 #include "platform.h"
 #include "core/pcie/linux/pcidev.h"
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <shared_mutex>
+#include <unordered_map>
 
 namespace shim_xdna {
 
+class completion_reactor;
+class bo_pool;
+class slab_allocator;
+class buffer;
+
+// BO handle to buffer mapping. DRM handles are small integers, so they index
+// into a two level table directly. Lookups are lock free, updates are
+// serialized. Handles beyond the table go to a locked map.
+class bo_handle_table
+{
+public:
+  ~bo_handle_table();
+
+  void
+  insert(uint64_t handle, xrt_core::buffer_handle *ptr);
+
+  void
+  remove(uint64_t handle);
+
+  // nullptr if not found.
+  xrt_core::buffer_handle *
+  find(uint64_t handle) const;
+
+private:
+  static constexpr size_t page_shift = 10;
+  static constexpr size_t page_entries = 1ul << page_shift;
+  static constexpr size_t max_pages = 1024;
+  using page = std::array<std::atomic<xrt_core::buffer_handle *>, page_entries>;
+
+  std::array<std::atomic<page *>, max_pages> m_pages = {};
+  std::mutex m_update_lock;
+
+  mutable std::shared_mutex m_overflow_lock;
+  std::unordered_map<uint64_t, xrt_core::buffer_handle *> m_overflow;
+};
+
 class pdev : public xrt_core::pci::dev
 {
 public:
@@ -79,6 +119,10 @@ public:
   virtual void *
   get_heap_vaddr() const = 0;
 
+  // Device heap BO, nullptr if device does not have one.
+  virtual const buffer *
+  get_heap_bo() const = 0;
+
   virtual bool
   is_umq() const = 0;
 
@@ -95,6 +139,21 @@ public:
   xrt_core::buffer_handle *
   find_bo_by_handle(uint64_t handle) const;
 
+  // Device wide completion thread, created on first use and torn down
+  // when device is closed by last user.
+  completion_reactor&
+  get_completion_reactor() const;
+
+  // Device wide cache of freed BOs, nullptr when disabled or device is not
+  // opened. Cached BOs are freed when device is closed by last user.
+  std::shared_ptr<bo_pool>
+  get_bo_pool() const;
+
+  // Device wide sub-allocator for small SHARE BOs, nullptr when disabled or
+  // device is not opened.
+  std::shared_ptr<slab_allocator>
+  get_slab_allocator() const;
+
 private:
   virtual void
   on_first_open() const = 0;
@@ -107,8 +166,14 @@ private:
   mutable int m_dev_users = 0;
   mutable std::mutex m_open_close_lock;
 
-  mutable std::shared_mutex m_bo_map_lock;
-  mutable std::unordered_map<uint64_t, xrt_core::buffer_handle *> m_bo_map;
+  mutable bo_handle_table m_bo_map;
+
+  mutable std::mutex m_reactor_lock;
+  mutable std::unique_ptr<completion_reactor> m_reactor;
+
+  mutable std::mutex m_bo_pool_lock;
+  mutable std::shared_ptr<bo_pool> m_bo_pool;
+  mutable std::shared_ptr<slab_allocator> m_slab_alloc;
 };
 
 }
@@ -144,6 +144,63 @@ import_syncobj(export_import_syncobj_arg& sobj_arg) const
   sobj_arg.handle = arg.handle;
 }
 
+void
+platform_drv::
+export_sync_file(sync_file_arg& sobj_arg) const
+{
+  // sync_file carries a single fence, move the point to a binary syncobj first.
+  create_destroy_syncobj_arg tmp = {};
+  create_syncobj(tmp);
+  try {
+    drm_syncobj_transfer targ = {};
+    targ.src_handle = sobj_arg.handle;
+    targ.dst_handle = tmp.handle;
+    targ.src_point = sobj_arg.timepoint;
+    targ.dst_point = 0;
+    /* Block till the point is submitted */
+    targ.flags = DRM_SYNCOBJ_WAIT_FLAGS_WAIT_FOR_SUBMIT;
+    ioctl(dev_fd(), DRM_IOCTL_SYNCOBJ_TRANSFER, &targ);
+
+    drm_syncobj_handle arg = {};
+    arg.handle = tmp.handle;
+    arg.flags = DRM_SYNCOBJ_HANDLE_TO_FD_FLAGS_EXPORT_SYNC_FILE;
+    arg.fd = -1;
+    ioctl(dev_fd(), DRM_IOCTL_SYNCOBJ_HANDLE_TO_FD, &arg);
+    sobj_arg.fd = arg.fd;
+  } catch (...) {
+    destroy_syncobj(tmp);
+    throw;
+  }
+  destroy_syncobj(tmp);
+}
+
+void
+platform_drv::
+import_sync_file(sync_file_arg& sobj_arg) const
+{
+  create_destroy_syncobj_arg tmp = {};
+  create_syncobj(tmp);
+  try {
+    drm_syncobj_handle arg = {};
+    arg.handle = tmp.handle;
+    arg.flags = DRM_SYNCOBJ_FD_TO_HANDLE_FLAGS_IMPORT_SYNC_FILE;
+    arg.fd = sobj_arg.fd;
+    ioctl(dev_fd(), DRM_IOCTL_SYNCOBJ_FD_TO_HANDLE, &arg);
+
+    drm_syncobj_transfer targ = {};
+    targ.src_handle = tmp.handle;
+    targ.dst_handle = sobj_arg.handle;
+    targ.src_point = 0;
+    targ.dst_point = sobj_arg.timepoint;
+    targ.flags = 0;
+    ioctl(dev_fd(), DRM_IOCTL_SYNCOBJ_TRANSFER, &targ);
+  } catch (...) {
+    destroy_syncobj(tmp);
+    throw;
+  }
+  destroy_syncobj(tmp);
+}
+
 void
 platform_drv::
 wait_syncobj(wait_syncobj_arg& sobj_arg) const
@@ -158,6 +215,39 @@ wait_syncobj(wait_syncobj_arg& sobj_arg) const
   ioctl(dev_fd(), DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT, &arg);
 }
 
+void
+platform_drv::
+wait_syncobjs(wait_syncobjs_arg& sobj_arg) const
+{
+  if (sobj_arg.handles.size() != sobj_arg.timepoints.size())
+    shim_err(EINVAL, "Num of syncobj handles and points not equal (%ld/%ld)",
+      sobj_arg.handles.size(), sobj_arg.timepoints.size());
+
+  drm_syncobj_timeline_wait arg = {};
+  arg.handles = reinterpret_cast<uintptr_t>(sobj_arg.handles.data());
+  arg.points = reinterpret_cast<uintptr_t>(sobj_arg.timepoints.data());
+  arg.timeout_nsec = timeout_ms2abs_ns(sobj_arg.timeout_ms);
+  arg.count_handles = sobj_arg.handles.size();
+  /* Keep waiting even if not submitted yet */
+  arg.flags = DRM_SYNCOBJ_WAIT_FLAGS_WAIT_FOR_SUBMIT;
+  if (sobj_arg.wait_all)
+    arg.flags |= DRM_SYNCOBJ_WAIT_FLAGS_WAIT_ALL;
+  ioctl(dev_fd(), DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT, &arg);
+  sobj_arg.first_signaled = arg.first_signaled;
+}
+
+void
+platform_drv::
+query_syncobjs(query_syncobjs_arg& sobj_arg) const
+{
+  sobj_arg.timepoints.resize(sobj_arg.handles.size());
+  drm_syncobj_timeline_array arg = {};
+  arg.handles = reinterpret_cast<uintptr_t>(sobj_arg.handles.data());
+  arg.points = reinterpret_cast<uintptr_t>(sobj_arg.timepoints.data());
+  arg.count_handles = sobj_arg.handles.size();
+  ioctl(dev_fd(), DRM_IOCTL_SYNCOBJ_QUERY, &arg);
+}
+
 void
 platform_drv::
 signal_syncobj(signal_syncobj_arg& sobj_arg) const
@@ -207,6 +297,15 @@ drv_ioctl(drv_ioctl_cmd cmd, void* cmd_arg) const
   case drv_ioctl_cmd::submit_cmd:
     submit_cmd(*static_cast<submit_cmd_arg*>(cmd_arg));
     break;
+  case drv_ioctl_cmd::submit_cmds:
+    submit_cmds(*static_cast<submit_cmds_arg*>(cmd_arg));
+    break;
+  case drv_ioctl_cmd::submit_dependency:
+    submit_dependency(*static_cast<submit_dependency_arg*>(cmd_arg));
+    break;
+  case drv_ioctl_cmd::submit_signal:
+    submit_signal(*static_cast<submit_signal_arg*>(cmd_arg));
+    break;
   case drv_ioctl_cmd::wait_cmd_ioctl:
     wait_cmd_ioctl(*static_cast<wait_cmd_arg*>(cmd_arg));
     break;
@@ -234,12 +333,24 @@ drv_ioctl(drv_ioctl_cmd cmd, void* cmd_arg) const
   case drv_ioctl_cmd::import_syncobj:
     import_syncobj(*static_cast<export_import_syncobj_arg*>(cmd_arg));
     break;
+  case drv_ioctl_cmd::export_sync_file:
+    export_sync_file(*static_cast<sync_file_arg*>(cmd_arg));
+    break;
+  case drv_ioctl_cmd::import_sync_file:
+    import_sync_file(*static_cast<sync_file_arg*>(cmd_arg));
+    break;
   case drv_ioctl_cmd::signal_syncobj:
     signal_syncobj(*static_cast<signal_syncobj_arg*>(cmd_arg));
     break;
   case drv_ioctl_cmd::wait_syncobj:
     wait_syncobj(*static_cast<wait_syncobj_arg*>(cmd_arg));
     break;
+  case drv_ioctl_cmd::wait_syncobjs:
+    wait_syncobjs(*static_cast<wait_syncobjs_arg*>(cmd_arg));
+    break;
+  case drv_ioctl_cmd::query_syncobjs:
+    query_syncobjs(*static_cast<query_syncobjs_arg*>(cmd_arg));
+    break;
   case drv_ioctl_cmd::get_sysfs:
     get_sysfs(*static_cast<get_sysfs_arg*>(cmd_arg));
     break;
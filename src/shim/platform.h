@@ -30,6 +30,9 @@ enum class drv_ioctl_cmd {
   import_bo,
 
   submit_cmd,
+  submit_cmds,
+  submit_dependency,
+  submit_signal,
   wait_cmd_ioctl,
   wait_cmd_syncobj,
 
@@ -44,8 +47,12 @@ enum class drv_ioctl_cmd {
   destroy_syncobj,
   export_syncobj,
   import_syncobj,
+  export_sync_file,
+  import_sync_file,
   signal_syncobj,
   wait_syncobj,
+  wait_syncobjs,
+  query_syncobjs,
 };
 
 struct bo_id {
@@ -119,10 +126,40 @@ struct export_bo_arg {
 struct submit_cmd_arg {
   uint32_t ctx_handle;
   bo_id cmd_bo;
-  const std::set<bo_id>& arg_bos;
+  // Sorted and deduplicated arg BO handles.
+  const std::vector<uint32_t>& arg_bos;
   uint64_t seq;
 };
 
+// Submit multiple cmd BOs in one go. The arg BOs are shared by all cmds.
+// On return, seq is for the last submitted cmd and submitted tells how many
+// cmds made it to driver, which is also valid when an exception is thrown.
+struct submit_cmds_arg {
+  uint32_t ctx_handle;
+  const std::vector<bo_id>& cmd_bos;
+  const std::vector<uint32_t>& arg_bos;
+  uint64_t seq;
+  size_t submitted;
+};
+
+// Submit a no-op cmd which is not scheduled before all syncobjs reach their
+// points. Cmds submitted after it on the same ctx run after it. On return,
+// seq is for the no-op cmd.
+struct submit_dependency_arg {
+  uint32_t ctx_handle;
+  const std::vector<uint32_t>& syncobj_handles;
+  const std::vector<uint64_t>& timepoints;
+  uint64_t seq;
+};
+
+// Have driver signal syncobj at the point once last cmd submitted on the ctx
+// is completed.
+struct submit_signal_arg {
+  uint32_t ctx_handle;
+  uint32_t syncobj_handle;
+  uint64_t timepoint;
+};
+
 struct wait_cmd_arg {
   union {
     uint32_t ctx_handle;
@@ -141,6 +178,14 @@ struct export_import_syncobj_arg {
   int fd;
 };
 
+// Export the fence at a timeline point of syncobj as sync_file fd, or import
+// sync_file fd as the fence at a timeline point. Import does not take over fd.
+struct sync_file_arg {
+  uint32_t handle;
+  uint64_t timepoint;
+  int fd;
+};
+
 struct signal_syncobj_arg {
   uint32_t handle;
   uint64_t timepoint;
@@ -152,6 +197,21 @@ struct wait_syncobj_arg {
   uint64_t timepoint;
 };
 
+// Wait for any (or all) of the timeline syncobjs to reach their points.
+struct wait_syncobjs_arg {
+  const std::vector<uint32_t>& handles;
+  const std::vector<uint64_t>& timepoints;
+  uint32_t timeout_ms;
+  bool wait_all;
+  uint32_t first_signaled;
+};
+
+// Read back current timeline points of the syncobjs.
+struct query_syncobjs_arg {
+  const std::vector<uint32_t>& handles;
+  std::vector<uint64_t>& timepoints;
+};
+
 struct get_sysfs_arg {
   const std::string& sysfs_node;
   std::vector<char>& data;
@@ -200,6 +260,12 @@ protected:
   virtual void
   wait_syncobj(wait_syncobj_arg& arg) const;
 
+  virtual void
+  wait_syncobjs(wait_syncobjs_arg& arg) const;
+
+  virtual void
+  query_syncobjs(query_syncobjs_arg& arg) const;
+
   virtual void
   destroy_syncobj(create_destroy_syncobj_arg& arg) const;
 
@@ -281,6 +347,18 @@ private:
   submit_cmd(submit_cmd_arg& arg) const
   { shim_not_supported_err(__func__); }
 
+  virtual void
+  submit_cmds(submit_cmds_arg& arg) const
+  { shim_not_supported_err(__func__); }
+
+  virtual void
+  submit_dependency(submit_dependency_arg& arg) const
+  { shim_not_supported_err(__func__); }
+
+  virtual void
+  submit_signal(submit_signal_arg& arg) const
+  { shim_not_supported_err(__func__); }
+
   virtual void
   wait_cmd_ioctl(wait_cmd_arg& arg) const
   { shim_not_supported_err(__func__); }
@@ -310,6 +388,12 @@ private:
   virtual void
   import_syncobj(export_import_syncobj_arg& arg) const;
 
+  virtual void
+  export_sync_file(sync_file_arg& arg) const;
+
+  virtual void
+  import_sync_file(sync_file_arg& arg) const;
+
   virtual void
   get_sysfs(get_sysfs_arg& arg) const
   { shim_not_supported_err(__func__); }
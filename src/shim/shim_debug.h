@@ -6,6 +6,7 @@
 
 #include "core/common/error.h"
 #include "core/common/debug.h"
+#include "core/common/config_reader.h"
 #include <cstdio>
 #include <memory>
 #include <unistd.h>
@@ -44,11 +45,25 @@ shim_not_supported_err(const char* msg)
   shim_err(ENOTSUP, msg);
 }
 
+#ifdef XDNA_SHIM_DEBUG
+// Debug messages compiled in can still be turned off in xrt.ini to keep
+// formatting off hot paths.
+inline bool
+shim_debug_enabled()
+{
+  static const bool enabled =
+    xrt_core::config::detail::get_bool_value("Debug.shim_debug", true);
+  return enabled;
+}
+#endif
+
 template <typename ...Args>
 void
 shim_debug(const char* fmt, Args&&... args)
 {
 #ifdef XDNA_SHIM_DEBUG
+  if (!shim_debug_enabled())
+    return;
   std::string format = "PID(%d): ";
   format += std::string(fmt);
   format += "\n";
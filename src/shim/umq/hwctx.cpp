@@ -3,15 +3,44 @@
 
 #include "hwctx.h"
 #include "hwq.h"
+#include "core/common/config_reader.h"
+#include <algorithm>
 
-namespace shim_xdna {
+namespace {
 
 // Allow at least one runlist (24 sub-cms) plus a few single cmds.
-const size_t total_queue_slots = 32;
+const size_t default_queue_slots = 32;
+const size_t min_queue_slots = 4;
+const size_t max_queue_slots = 1024;
+
+// Number of UMQ slots can be set per context by "umq_slots" QoS key, or for
+// all contexts by xrt.ini Debug.umq_slots.
+size_t
+get_queue_slots(const xrt::hw_context::qos_type& qos)
+{
+  static size_t ini_slots =
+    xrt_core::config::detail::get_uint_value("Debug.umq_slots", default_queue_slots);
+
+  size_t n = ini_slots;
+  auto it = qos.find("umq_slots");
+  if (it != qos.end() && it->second)
+    n = it->second;
+
+  n = std::clamp(n, min_queue_slots, max_queue_slots);
+  // Capacity has to be power of two.
+  size_t slots = 1;
+  while (slots < n)
+    slots <<= 1;
+  return slots;
+}
+
+}
+
+namespace shim_xdna {
 
 hwctx_umq::
 hwctx_umq(const device& device, const xrt::xclbin& xclbin, const qos_type& qos)
-  : hwctx(device, qos, xclbin, std::make_unique<hwq_umq>(device, total_queue_slots))
+  : hwctx(device, qos, xclbin, std::make_unique<hwq_umq>(device, get_queue_slots(qos)))
   , m_pdev(device.get_pdev())
 {
   shim_debug("Created UMQ HW context (%d)", get_slotidx());
@@ -21,7 +50,7 @@ hwctx_umq(const device& device, const xrt::xclbin& xclbin, const qos_type& qos)
 
 hwctx_umq::
 hwctx_umq(const device& device, uint32_t partition_size, const qos_type& qos)
-  : hwctx(device, qos, partition_size, std::make_unique<hwq_umq>(device, total_queue_slots))
+  : hwctx(device, qos, partition_size, std::make_unique<hwq_umq>(device, get_queue_slots(qos)))
   , m_pdev(device.get_pdev())
 {
   m_col_cnt = partition_size;
@@ -3,7 +3,13 @@
 
 #include "hwq.h"
 #include "core/common/trace.h"
+#include "core/common/config_reader.h"
+#include <chrono>
 #include <iostream>
+#include <thread>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
 
 namespace {
 
@@ -27,11 +33,57 @@ map_doorbell(const shim_xdna::pdev& pdev, uint32_t doorbell_offset)
     );
 }
 
+bool
+is_runlist_coalesced()
+{
+  static bool coalesce =
+    xrt_core::config::detail::get_bool_value("Debug.umq_coalesce_runlist", true);
+  return coalesce;
+}
+
+uint32_t
+get_doorbell_coalesce_count()
+{
+  static uint32_t cnt =
+    xrt_core::config::detail::get_uint_value("Debug.umq_doorbell_coalesce_count", 1);
+  return cnt;
+}
+
+uint32_t
+get_doorbell_coalesce_us()
+{
+  static uint32_t us =
+    xrt_core::config::detail::get_uint_value("Debug.umq_doorbell_coalesce_us", 50);
+  return us;
+}
+
 inline bool valid_queue_index(uint64_t read, uint64_t write, uint32_t capacity)
 {
   return (write >= read) && ((write - read) <= capacity);
 }
 
+// Copy a fully built pkt into its queue slot with as few wide stores as
+// the CPU allows, instead of field by field through volatile pointers.
+inline void
+publish_pkt(volatile struct host_queue_packet *dst, const struct host_queue_packet& src)
+{
+  static_assert(sizeof(struct host_queue_packet) == 64, "UMQ pkt must be one cache line");
+  auto d = const_cast<struct host_queue_packet *>(dst);
+#if defined(__AVX__)
+  auto sp = reinterpret_cast<const __m256i *>(&src);
+  auto dp = reinterpret_cast<__m256i *>(d);
+  _mm256_storeu_si256(dp, _mm256_load_si256(sp));
+  _mm256_storeu_si256(dp + 1, _mm256_load_si256(sp + 1));
+#elif defined(__SSE2__)
+  auto sp = reinterpret_cast<const __m128i *>(&src);
+  auto dp = reinterpret_cast<__m128i *>(d);
+  for (int i = 0; i < 4; i++)
+    _mm_storeu_si128(dp + i, _mm_load_si128(sp + i));
+#else
+  std::memcpy(d, &src, sizeof(src));
+#endif
+}
+
 }
 
 namespace shim_xdna {
@@ -148,41 +200,143 @@ dump_raw() const
   shim_debug("Finished dumping raw UMQ queue slot data\r\n");
 }
 
-uint32_t
+uint64_t
 hwq_umq::
-get_next_avail_slot()
+read_index(uint64_t wi) const
 {
-  uint64_t cur_slot = 0;
+  // CERT cannot update read index atomically. Host may read half-updated read
+  // index. The window is tiny, re-read a few times instead of sleeping.
+  constexpr int max_reads = 1000;
   auto h = m_umq_hdr;
 
-  do {
-    // Take a snapshot of read and write index in case they changes while being processed here
-    uint64_t wi = h->write_index;
-    uint64_t ri = h->read_index;
-
-    // CERT cannot update read index atomically. Host may read half-updated read index.
-    // If read bad value, wait for 100us, then retry once.
-    if (!valid_queue_index(ri, wi, h->capacity)) {
-      usleep(100);
-      wi = h->write_index;
-      ri = h->read_index;
-      if (!valid_queue_index(ri, wi, h->capacity)) {
-        // Invalid queue.
-        dump();
-        shim_err(EINVAL, "Invalid UMQ index! read_index=0x%lx, write_index=0x%lx", ri, wi);
-      }
-    } else if ((wi - ri) < h->capacity) {
-      // Found a slot.
-      cur_slot = wi;
+  uint64_t ri = 0;
+  for (int i = 0; i < max_reads; i++) {
+    ri = h->read_index;
+    if (valid_queue_index(ri, wi, h->capacity))
+      return ri;
+    std::this_thread::yield();
+  }
+  // Invalid queue.
+  dump();
+  shim_err(EINVAL, "Invalid UMQ index! read_index=0x%lx, write_index=0x%lx", ri, wi);
+}
+
+void
+hwq_umq::
+retire_slots(uint64_t ri) const
+{
+  auto retired = m_retired.load();
+  while (ri > retired && !m_retired.compare_exchange_weak(retired, ri))
+    ;
+  // Only bother waking up producer when it is waiting for slots.
+  if (ri > retired && m_slot_waiting) {
+    { std::lock_guard<std::mutex> lg(m_slot_lock); }
+    m_slot_cv.notify_all();
+  }
+}
+
+uint32_t
+hwq_umq::
+get_next_avail_slot(uint64_t wi)
+{
+  auto h = m_umq_hdr;
+  const auto cap = h->capacity;
+
+  // Slots between retired index and wi are in flight, the rest are credits.
+  // Credits are refreshed from read index only when they run out.
+  while (wi - m_retired.load() >= cap) {
+    retire_slots(read_index(wi));
+    auto retired = m_retired.load();
+    if (wi - retired < cap)
       break;
-    } else {
-      shim_debug("Queue is full, wait for next available slot");
-      // The ri is the first available slot.
-      hwq::wait_command(ri, 0);
+
+    shim_debug("Queue is full, wait for next available slot");
+    // Slots filled so far have to be seen by uC before we can wait on them.
+    if (h->write_index != wi) {
+      publish_write_index(wi);
+      ring_doorbell(false);
+    }
+
+    // Wait for the oldest slot to retire. Completion thread tells us when
+    // it's done, so we don't block in driver for every full queue event.
+    std::unique_lock<std::mutex> lk(m_slot_lock);
+    if (!m_slot_event_armed) {
+      m_slot_event_armed = add_completion_waiter(retired, [this](int) {
+        {
+          std::lock_guard<std::mutex> lg(m_slot_lock);
+          m_slot_event_armed = false;
+        }
+        m_slot_cv.notify_all();
+      });
+    }
+    if (!m_slot_event_armed) {
+      // No completion thread for this queue, block in driver.
+      lk.unlock();
+      hwq::wait_command(retired, 0);
+      continue;
+    }
+    m_slot_waiting = true;
+    m_slot_cv.wait(lk, [this, retired]() {
+      return !m_slot_event_armed || m_retired.load() != retired;
+    });
+    m_slot_waiting = false;
+  }
+
+  return wi & (cap - 1);
+}
+
+void
+hwq_umq::
+publish_write_index(uint64_t wi)
+{
+  // Make sure all writes to the slots and indirect buf are visible before
+  // write index moves. uC only looks at the slots after seeing the new write
+  // index, so release ordering is enough, no need for a full fence.
+  std::atomic_thread_fence(std::memory_order_release);
+  m_umq_hdr->write_index = wi;
+}
+
+void
+hwq_umq::
+ring_doorbell(bool coalesce)
+{
+  if (coalesce && m_db_thread.joinable()) {
+    std::lock_guard<std::mutex> lg(m_db_lock);
+    if (++m_db_deferred < get_doorbell_coalesce_count()) {
+      // First deferred one starts the window.
+      if (m_db_deferred == 1)
+        m_db_cv.notify_one();
+      return;
     }
-  } while (true);
+    m_db_deferred = 0;
+  }
+  // Wake up uC in case it is sleeping and waiting.
+  *m_mapped_doorbell = 0;
+}
+
+void
+hwq_umq::
+doorbell_flusher()
+{
+  const auto window = std::chrono::microseconds(get_doorbell_coalesce_us());
+  std::unique_lock<std::mutex> lk(m_db_lock);
 
-  return cur_slot & (h->capacity - 1);
+  while (!m_db_stop) {
+    m_db_cv.wait(lk, [this]() { return m_db_stop || m_db_deferred; });
+    if (m_db_stop)
+      break;
+    // Give more submissions a chance to show up, then ring for all of them.
+    m_db_cv.wait_for(lk, window, [this]() { return m_db_stop || !m_db_deferred; });
+    if (m_db_deferred) {
+      m_db_deferred = 0;
+      *m_mapped_doorbell = 0;
+    }
+  }
+  // Don't leave anything behind.
+  if (m_db_deferred) {
+    m_db_deferred = 0;
+    *m_mapped_doorbell = 0;
+  }
 }
 
 volatile struct host_queue_packet *
@@ -194,7 +348,7 @@ get_pkt(uint32_t index)
 
 uint64_t
 hwq_umq::
-issue_single_exec_buf(const cmd_buffer *cmd_bo, bool last_of_chain)
+issue_single_exec_buf(const cmd_buffer *cmd_bo, bool last_of_chain, uint64_t wi)
 {
   auto cmd = reinterpret_cast<ert_start_kernel_cmd *>(cmd_bo->vaddr());
   auto dpu = get_ert_dpu_data(cmd);
@@ -210,33 +364,28 @@ issue_single_exec_buf(const cmd_buffer *cmd_bo, bool last_of_chain)
     shim_err(EINVAL, "No dpu data, invalid exec buf");
   }
 
-  auto slot_idx = get_next_avail_slot();
+  auto slot_idx = get_next_avail_slot(wi);
 
+  // Build pkt off queue, publish it in one go once it's complete.
+  alignas(64) struct host_queue_packet pkt = {};
   if (get_ert_dpu_data_next(dpu))
-    fill_indirect_exec_buf(slot_idx, m_umq_hdr->capacity, dpu);
+    fill_indirect_exec_buf(pkt, slot_idx, m_umq_hdr->capacity, dpu);
   else
-    fill_direct_exec_buf(slot_idx, dpu);
+    fill_direct_exec_buf(pkt, dpu);
 
-  auto pkt = get_pkt(slot_idx);
-  auto hdr = &pkt->xrt_header;
+  auto hdr = &pkt.xrt_header;
   hdr->common_header.opcode = HOST_QUEUE_PACKET_EXEC_BUF;
   hdr->common_header.chain_flag = last_of_chain ? LAST_CMD : NOT_LAST_CMD;
   // Completion signal area has to be a full WORD, we utilize the command_bo header.
   hdr->completion_signal = cmd_bo->paddr() + offsetof(ert_start_kernel_cmd, header);
   // TODO: remove once uC stops looking at and updating this field.
   hdr->common_header.type = HOST_QUEUE_PACKET_TYPE_VENDOR_SPECIFIC;
-  // Issue mfence instruction to make sure all writes to the slot before is done.
-  std::atomic_thread_fence(std::memory_order_seq_cst);
-  // Indicates the slot is ready for processing by uC.
-  // Must be the last step after pkt is filled up.
-  uint64_t wi = m_umq_hdr->write_index;
-  m_umq_hdr->write_index = wi + 1;
+  publish_pkt(get_pkt(slot_idx), pkt);
 
-  // Wake up uC in case it is sleeping and waiting.
-  *m_mapped_doorbell = 0;
+  // Slot is not visible to uC until write index is published by caller.
   XRT_DETAIL_TRACE_POINT_LOG(umq_cmd_submitted, cmd_bo->id().handle, wi);
 
-  shim_debug("Submitted %s-uC %scommand (%ld)",
+  shim_debug("Filled %s-uC %scommand (%ld)",
     get_ert_dpu_data_next(dpu) ? "multi" : "single",
     last_of_chain ? "last-of-chain " : "middle-of-chain",
     wi);
@@ -245,22 +394,20 @@ issue_single_exec_buf(const cmd_buffer *cmd_bo, bool last_of_chain)
 
 void
 hwq_umq::
-fill_indirect_exec_buf(uint32_t slot_idx, uint32_t total_slots, ert_dpu_data *dpu)
+fill_indirect_exec_buf(struct host_queue_packet& pkt, uint32_t slot_idx, uint32_t total_slots,
+  ert_dpu_data *dpu)
 {
-  auto pkt = get_pkt(slot_idx);
   auto pkt_size = (dpu->chained + 1) * sizeof(struct host_indirect_packet_entry);
 
   if (dpu->chained >= HSA_MAX_LEVEL1_INDIRECT_ENTRIES)
     shim_err(EINVAL, "unsupported indirect number %d, valid number <= %d",
       dpu->chained + 1, HSA_MAX_LEVEL1_INDIRECT_ENTRIES);
 
-  if (pkt_size > sizeof(pkt->data))
+  if (pkt_size > sizeof(pkt.data))
     shim_err(EINVAL, "dpu pkt_size=0x%zx > pkt_data max size=0x%zx",
-      pkt_size, sizeof(pkt->data));
+      pkt_size, sizeof(pkt.data));
 
-  // no need to memset to zero, all buffer will be set
-  volatile struct host_indirect_packet_entry *hp =
-    reinterpret_cast<volatile struct host_indirect_packet_entry *>(pkt->data);
+  auto hp = reinterpret_cast<struct host_indirect_packet_entry *>(pkt.data);
 
   uint32_t max_entries = dpu->chained + 1;
   for (uint32_t i = 0; dpu && i < max_entries; hp++, dpu = get_ert_dpu_data_next(dpu), i++) {
@@ -274,21 +421,18 @@ fill_indirect_exec_buf(uint32_t slot_idx, uint32_t total_slots, ert_dpu_data *dp
     hp->host_addr_high = static_cast<uint32_t>(buf_paddr >> 32);
     hp->uc_index = uci;
 
-    auto cebp = &m_umq_indirect_buf[prefix_idx];
-    // do not zero this buffer, the cebp->header is pre-set
-    // set every cebp->payload field in case of garbage data
-    cebp->payload.dpu_control_code_host_addr_low =
-      static_cast<uint32_t>(dpu->instruction_buffer);
-    cebp->payload.dpu_control_code_host_addr_high =
-      static_cast<uint32_t>(dpu->instruction_buffer >> 32);
-    cebp->payload.args_len = 0;
-    cebp->payload.args_host_addr_low = 0;
-    cebp->payload.args_host_addr_high = 0;
-    cebp->payload.dtrace_buf_host_addr_low = static_cast<uint32_t>(dpu->dtrace_buffer);
-    cebp->payload.dtrace_buf_host_addr_high = static_cast<uint16_t>(dpu->dtrace_buffer >> 32);
+    // The cebp->header is pre-set, set every payload field in case of
+    // garbage data and copy it over in one go.
+    struct exec_buf payload = {};
+    payload.dpu_control_code_host_addr_low = static_cast<uint32_t>(dpu->instruction_buffer);
+    payload.dpu_control_code_host_addr_high = static_cast<uint32_t>(dpu->instruction_buffer >> 32);
+    payload.dtrace_buf_host_addr_low = static_cast<uint32_t>(dpu->dtrace_buffer);
+    payload.dtrace_buf_host_addr_high = static_cast<uint16_t>(dpu->dtrace_buffer >> 32);
+    auto cebp = const_cast<struct host_indirect_data *>(&m_umq_indirect_buf[prefix_idx]);
+    std::memcpy(&cebp->payload, &payload, sizeof(payload));
   }
 
-  auto hdr = &pkt->xrt_header;
+  auto hdr = &pkt.xrt_header;
   hdr->common_header.distribute = 1;
   hdr->common_header.indirect = 1;
   hdr->common_header.count = pkt_size;
@@ -296,26 +440,22 @@ fill_indirect_exec_buf(uint32_t slot_idx, uint32_t total_slots, ert_dpu_data *dp
 
 void
 hwq_umq::
-fill_direct_exec_buf(uint32_t slot_idx, ert_dpu_data *dpu)
+fill_direct_exec_buf(struct host_queue_packet& pkt, ert_dpu_data *dpu)
 {
-  auto pkt = get_pkt(slot_idx);
   auto pkt_size = sizeof(struct exec_buf);
 
-  if (pkt_size > sizeof(pkt->data))
+  if (pkt_size > sizeof(pkt.data))
     shim_err(EINVAL, "dpu pkt_size=0x%lx > pkt_data max size=%x%lx",
-      pkt_size, sizeof(pkt->data));
+      pkt_size, sizeof(pkt.data));
 
-  // zero this buffer
-  auto data = const_cast<uint32_t *>(pkt->data);
-  std::memset(data, 0, pkt_size);
-  // set correct dpu control code
-  volatile struct exec_buf *ebp = reinterpret_cast<volatile struct exec_buf *>(pkt->data);
+  // pkt is zeroed by caller, set correct dpu control code
+  auto ebp = reinterpret_cast<struct exec_buf *>(pkt.data);
   ebp->dpu_control_code_host_addr_low = static_cast<uint32_t>(dpu->instruction_buffer);
   ebp->dpu_control_code_host_addr_high = static_cast<uint32_t>(dpu->instruction_buffer >> 32);
   ebp->dtrace_buf_host_addr_low = static_cast<uint32_t>(dpu->dtrace_buffer);
   ebp->dtrace_buf_host_addr_high = static_cast<uint16_t>(dpu->dtrace_buffer >> 32);
 
-  auto hdr = &pkt->xrt_header;
+  auto hdr = &pkt.xrt_header;
   hdr->common_header.distribute = 0;
   hdr->common_header.indirect = 0;
   hdr->common_header.count = pkt_size;
@@ -330,23 +470,57 @@ issue_command(const cmd_buffer *cmd_bo)
 
   auto cmd = reinterpret_cast<ert_packet *>(cmd_bo->vaddr());
 
-  // Single command submission.
-  if (cmd->opcode != ERT_CMD_CHAIN)
-    return issue_single_exec_buf(cmd_bo, true);
+  uint64_t wi = m_umq_hdr->write_index;
+
+  // Single command submission. Doorbell may be coalesced with following ones.
+  if (cmd->opcode != ERT_CMD_CHAIN) {
+    auto seq = issue_single_exec_buf(cmd_bo, true, wi);
+    publish_write_index(seq + 1);
+    ring_doorbell(true);
+    return seq;
+  }
 
   // Runlist command submission.
   auto payload = get_ert_cmd_chain_data(cmd);
   if (payload->command_count == 0 || payload->command_count > 64)
     shim_err(EINVAL, "Runlist exec buf with bad num of subcmds: %zx", payload->command_count);
 
+  // In coalesced mode, all subcmds are filled in before write index moves
+  // and doorbell is rung once for the whole runlist.
+  auto coalesce = is_runlist_coalesced();
   uint64_t seq = 0;
   for (size_t i = 0; i < payload->command_count; i++) {
     auto subcmd = static_cast<const cmd_buffer *>(m_pdev.find_bo_by_handle(payload->data[i]));
-    seq = issue_single_exec_buf(subcmd, i == payload->command_count - 1);
+    seq = issue_single_exec_buf(subcmd, i == payload->command_count - 1, wi);
+    wi = seq + 1;
+    if (!coalesce) {
+      publish_write_index(wi);
+      ring_doorbell(false);
+    }
+  }
+  if (coalesce) {
+    publish_write_index(wi);
+    ring_doorbell(false);
   }
   return seq;
 }
 
+bool
+hwq_umq::
+can_batch_submit() const
+{
+  // Cmds written to host queue directly are already cheap to submit.
+  return is_kernel_mode_submission();
+}
+
+bool
+hwq_umq::
+can_submit_fence() const
+{
+  // Driver does not hold back cmds on dependencies for user mode queue.
+  return false;
+}
+
 void
 hwq_umq::
 bind_hwctx(const hwctx& ctx)
@@ -357,6 +531,12 @@ bind_hwctx(const hwctx& ctx)
   auto doorbell_offset = ctx.get_doorbell();
   if (doorbell_offset != AMDXDNA_INVALID_DOORBELL_OFFSET)
     m_mapped_doorbell = map_doorbell(m_pdev, ctx.get_doorbell());
+
+  // Flusher makes sure a deferred doorbell is rung within the window.
+  if (m_mapped_doorbell && get_doorbell_coalesce_count() > 1) {
+    m_db_stop = false;
+    m_db_thread = std::thread(&hwq_umq::doorbell_flusher, this);
+  }
 }
 
 void
@@ -365,9 +545,19 @@ unbind_hwctx()
 {
   // unlink hwctx by parent class
   hwq::unbind_hwctx();
+  // stop doorbell flusher before doorbell goes away
+  if (m_db_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lg(m_db_lock);
+      m_db_stop = true;
+    }
+    m_db_cv.notify_all();
+    m_db_thread.join();
+  }
   // teardown doorbell mapping by child class
   if (m_mapped_doorbell)
     m_pdev.munmap(const_cast<uint32_t*>(m_mapped_doorbell), sizeof(uint32_t));
+  m_mapped_doorbell = nullptr;
 }
 
 bo_id
@@ -518,7 +708,10 @@ poll_command(xrt_core::buffer_handle *cmd) const
 
   auto boh = static_cast<cmd_buffer*>(cmd);
   auto seq = boh->wait_for_submitted();
-  if (m_umq_hdr->read_index <= seq)
+  auto ri = read_index(m_umq_hdr->write_index);
+  // Every completion seen here frees up slots for producer.
+  retire_slots(ri);
+  if (ri <= seq)
     return 0;
 
   // Command is completed as indicated by read index, update result.
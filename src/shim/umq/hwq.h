@@ -42,26 +42,65 @@ private:
   uint64_t m_indirect_paddr;
   volatile uint32_t *m_mapped_doorbell = nullptr;
 
+  // Host side slot credits. m_retired is the highest read index seen by
+  // anyone, producer waits on m_slot_cv for it to move when queue is full.
+  mutable std::atomic<uint64_t> m_retired{0};
+  mutable std::atomic<bool> m_slot_waiting{false};
+  mutable std::mutex m_slot_lock;
+  mutable std::condition_variable m_slot_cv;
+  bool m_slot_event_armed = false;
+
+  // Doorbell coalescing for back to back single cmd submissions.
+  std::mutex m_db_lock;
+  std::condition_variable m_db_cv;
+  uint32_t m_db_deferred = 0;
+  bool m_db_stop = false;
+  std::thread m_db_thread;
+
   uint64_t
   issue_command(const cmd_buffer *cmd_bo) override;
 
+  bool
+  can_batch_submit() const override;
+
+  bool
+  can_submit_fence() const override;
+
   void
   dump_raw() const;
 
   uint32_t
-  get_next_avail_slot();
+  get_next_avail_slot(uint64_t wi);
+
+  uint64_t
+  read_index(uint64_t wi) const;
+
+  void
+  retire_slots(uint64_t ri) const;
+
+  void
+  publish_write_index(uint64_t wi);
+
+  // Coalesced ring may be deferred for a short window, see doorbell_flusher().
+  void
+  ring_doorbell(bool coalesce);
+
+  void
+  doorbell_flusher();
 
   volatile struct host_queue_packet *
   get_pkt(uint32_t index);
 
   void
-  fill_direct_exec_buf(uint32_t idx, ert_dpu_data *dpu);
+  fill_direct_exec_buf(struct host_queue_packet& pkt, ert_dpu_data *dpu);
 
-  void 
-  fill_indirect_exec_buf(uint32_t idx, uint32_t total_slots, ert_dpu_data *dpu);
+  void
+  fill_indirect_exec_buf(struct host_queue_packet& pkt, uint32_t idx, uint32_t total_slots,
+    ert_dpu_data *dpu);
 
+  // Fill slot for write index wi, caller publishes write index afterwards.
   uint64_t
-  issue_single_exec_buf(const cmd_buffer *cmd_bo, bool last_of_chain);
+  issue_single_exec_buf(const cmd_buffer *cmd_bo, bool last_of_chain, uint64_t wi);
 
   bool
   is_kernel_mode_submission() const;
@@ -38,6 +38,13 @@ get_heap_vaddr() const
   return nullptr;
 }
 
+const buffer *
+pdev_umq::
+get_heap_bo() const
+{
+  return nullptr;
+}
+
 uint64_t
 pdev_umq::
 get_heap_paddr() const
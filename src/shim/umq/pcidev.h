@@ -23,6 +23,9 @@ public:
   void *
   get_heap_vaddr() const override;
 
+  const buffer *
+  get_heap_bo() const override;
+
   bool
   is_umq() const override;
 
@@ -9,6 +9,7 @@
 #include "amdxdna_proto.h"
 #include "platform_virtio.h"
 #include "core/common/trace.h"
+#include "core/common/config_reader.h"
 #include <poll.h>
 #include <cstddef>
 #include <cstring>
@@ -21,6 +22,65 @@ namespace {
 
 const size_t resp_buffer_size = 0x1000;
 
+// Submit cmds without waiting for host to return seq, if host supports it.
+bool
+use_async_exec()
+{
+  static const bool async =
+    xrt_core::config::detail::get_bool_value("Debug.virtio_async_exec", true);
+  return async;
+}
+
+// Most of info buffers are tiny, keep a few of them around for next query.
+const size_t max_info_bufs = 4;
+
+// How long a get_info result can be reused by guest, zero means never.
+std::chrono::steady_clock::duration
+get_info_ttl(uint32_t param)
+{
+  static const auto ttl = std::chrono::milliseconds(
+    xrt_core::config::detail::get_uint_value("Debug.virtio_info_cache_ms", 1000));
+
+  if (ttl.count() == 0)
+    return ttl;
+
+  switch (param) {
+  // Fixed for the life of the device.
+  case DRM_AMDXDNA_QUERY_AIE_METADATA:
+  case DRM_AMDXDNA_QUERY_AIE_VERSION:
+  case DRM_AMDXDNA_QUERY_FIRMWARE_VERSION:
+  case DRM_AMDXDNA_QUERY_CERT_FIRMWARE_VERSION:
+  case DRM_AMDXDNA_QUERY_RESOURCE_INFO:
+    return std::chrono::steady_clock::duration::max();
+  // Only changed from host side, e.g. by host admin.
+  case DRM_AMDXDNA_QUERY_CLOCK_METADATA:
+  case DRM_AMDXDNA_GET_POWER_MODE:
+    return ttl;
+  default:
+    return std::chrono::steady_clock::duration::zero();
+  }
+}
+
+// Bytes of ccmds batched before they are flushed to host, 0 disables batching.
+size_t
+get_batch_size()
+{
+  static const size_t sz =
+    xrt_core::config::detail::get_uint_value("Debug.virtio_batch_size", 4096);
+  return sz;
+}
+
+// Number of hypercalls with response which can be outstanding at once.
+uint32_t
+get_resp_slots()
+{
+  static const uint32_t slots = [] {
+    auto n = xrt_core::config::detail::get_uint_value("Debug.virtio_resp_slots", 32);
+    return n ? static_cast<uint32_t>(n) : 1u;
+  }();
+  return slots;
+}
+
 size_t
 roundup_64bit(size_t size)
 {
@@ -147,6 +207,10 @@ hcall_cmd2name(unsigned long cmd)
     return "AMDXDNA_CCMD_READ_SYSFS";
   case AMDXDNA_CCMD_SYNC_BO:
     return "AMDXDNA_CCMD_SYNC_BO";
+  case AMDXDNA_CCMD_EXEC_CMD_ASYNC:
+    return "AMDXDNA_CCMD_EXEC_CMD_ASYNC";
+  case AMDXDNA_CCMD_SYNC_BO_ASYNC:
+    return "AMDXDNA_CCMD_SYNC_BO_ASYNC";
   }
 
   return "UNKNOWN(" + std::to_string(cmd) + ")";
@@ -270,7 +334,7 @@ register_resp_buf(int dev_fd, uint32_t res_id)
   hcall_no_wait(dev_fd, &req, sizeof(req));
 }
 
-uint32_t
+vaccel_drm_capset
 get_capset(int dev_fd)
 {
   vaccel_drm_capset caps = {};
@@ -281,7 +345,7 @@ get_capset(int dev_fd)
     .size = sizeof(caps),
   };
   ioctl(dev_fd, DRM_IOCTL_VIRTGPU_GET_CAPS, &args);
-  return caps.context_type;
+  return caps;
 }
 
 static bool
@@ -436,6 +500,13 @@ get() const
   return m_ptr;
 }
 
+size_t
+platform_drv_virtio::response_buffer::
+size() const
+{
+  return m_size;
+}
+
 //
 // Implementation of platform_drv_virtio.
 //
@@ -448,7 +519,8 @@ drv_open(const std::string& sysfs_name) const
   platform_drv::drv_open(sysfs_name);
 
   auto fd = dev_fd();
-  if (get_capset(fd) != VIRTGPU_DRM_CONTEXT_AMDXDNA)
+  auto caps = get_capset(fd);
+  if (caps.context_type != VIRTGPU_DRM_CONTEXT_AMDXDNA)
     // This function is called by XRT when it scans devices to find out the NPU
     // device in VM such as QEMU KVM. When there is an exception, XRT will only
     // continue to scan when it is std::invalid_argument. And thus, we throw
@@ -459,13 +531,37 @@ drv_open(const std::string& sysfs_name) const
   // Check if host memory is available via VIRTGPU_GETPARAM
   m_use_hostmem = get_host_visible(fd);
 
+  m_wire_version = caps.wire_format_version;
+  shim_debug("Host wire format version %u", m_wire_version);
+
   set_virtgpu_context(fd);
-  m_resp_buf = std::make_unique<response_buffer>(fd);
+  // Older host writes all responses at offset 0, share one slot there.
+  auto slots = has_resp_slots() ? get_resp_slots() : 0;
+  m_async_exec = use_async_exec() && m_wire_version >= AMDXDNA_WIRE_FORMAT_ASYNC_EXEC;
+  // Slot 0 is left for responses of hypercalls no one waits for. Error words
+  // of async exec waits go to one more page after the slots.
+  m_err_off = (slots + 1) * resp_buffer_size;
+  auto buf_size = m_err_off + (m_async_exec ? resp_buffer_size : 0);
+  m_resp_buf = std::make_unique<response_buffer>(fd, buf_size);
   try {
     register_resp_buf(fd, m_resp_buf->res_id());
   } catch (const xrt_core::system_error& e) {
     std::cout << "Failed to register response buffer with host: " << e.what() << std::endl;
     m_resp_buf.reset();
+    m_async_exec = false;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lg(m_lock);
+  m_free_slots.clear();
+  for (uint32_t i = slots; i > 0; i--)
+    m_free_slots.push_back(i);
+  if (m_free_slots.empty())
+    m_free_slots.push_back(0);
+  m_free_err_words.clear();
+  if (m_async_exec) {
+    for (uint32_t off = resp_buffer_size; off > 0; off -= sizeof(amdxdna_ccmd_rsp))
+      m_free_err_words.push_back(m_err_off + off - sizeof(amdxdna_ccmd_rsp));
   }
 }
 
@@ -473,6 +569,20 @@ void
 platform_drv_virtio::
 drv_close() const
 {
+  try {
+    flush();
+  } catch (const xrt_core::system_error& e) {
+    std::cout << "Failed to flush batched host calls: " << e.what() << std::endl;
+  }
+  {
+    std::lock_guard<std::mutex> lg(m_lock);
+    m_free_slots.clear();
+  }
+  {
+    std::lock_guard<std::mutex> lg(m_info_lock);
+    m_info_cache.clear();
+    m_info_bufs.clear();
+  }
   m_resp_buf.reset();
 
   // Call into parent to close the device node.
@@ -486,28 +596,167 @@ hcall(void *req) const
   // Assume the request buffer always starts with vdrm_ccmd_req!
   auto hdr = reinterpret_cast<vdrm_ccmd_req*>(req);
   auto fd = dev_fd();
+  // Batched ccmds go first, caller may depend on them.
+  flush();
   hcall_wait(fd, req, hdr->len);
 }
 
+void
+platform_drv_virtio::
+batch_locked(const void *req) const
+{
+  auto hdr = reinterpret_cast<const vdrm_ccmd_req*>(req);
+  auto off = m_batch.size();
+  m_batch.resize(off + roundup_64bit(hdr->len) / sizeof(uint64_t));
+  std::memcpy(&m_batch[off], req, hdr->len);
+}
+
+void
+platform_drv_virtio::
+flush_locked() const
+{
+  if (m_batch.empty())
+    return;
+
+  auto fd = dev_fd();
+  auto free_bos = [this, fd] {
+    auto bos = std::move(m_batch_bos);
+    m_batch_bos.clear();
+    for (auto bo : bos)
+      drm_bo_free(fd, bo);
+  };
+
+  shim_debug("Flushing %zu bytes of batched HCALL", m_batch.size() * sizeof(uint64_t));
+  try {
+    hcall_no_wait(fd, m_batch.data(), m_batch.size() * sizeof(uint64_t));
+  } catch (...) {
+    // Batch is lost, so are the requests destroying the BOs in it. Close
+    // them anyway so that they don't go with the next batch, host frees
+    // what is left along with the context.
+    m_batch.clear();
+    try {
+      free_bos();
+    } catch (const xrt_core::system_error& e) {
+      shim_debug("Failed to close BOs of lost batch: %s", e.what());
+    }
+    throw;
+  }
+  m_batch.clear();
+  free_bos();
+}
+
+void
+platform_drv_virtio::
+flush() const
+{
+  std::lock_guard<std::mutex> lg(m_exec_lock);
+  flush_locked();
+}
+
+void
+platform_drv_virtio::
+hcall_batched(void *req, uint32_t res_id) const
+{
+  std::lock_guard<std::mutex> lg(m_exec_lock);
+  batch_locked(req);
+  if (res_id != AMDXDNA_INVALID_BO_HANDLE)
+    m_batch_bos.push_back(res_id);
+  if (m_batch.size() * sizeof(uint64_t) >= get_batch_size())
+    flush_locked();
+}
+
+bool
+platform_drv_virtio::
+has_resp_slots() const
+{
+  return m_wire_version >= AMDXDNA_WIRE_FORMAT_RSP_SLOTS;
+}
+
+amdxdna_ccmd_rsp *
+platform_drv_virtio::
+get_err_word(uint32_t& rsp_off) const
+{
+  {
+    std::unique_lock<std::mutex> lk(m_lock);
+    m_err_word_cv.wait(lk, [this] { return !m_free_err_words.empty(); });
+    rsp_off = m_free_err_words.back();
+    m_free_err_words.pop_back();
+  }
+  auto rsp = reinterpret_cast<amdxdna_ccmd_rsp*>(static_cast<char*>(m_resp_buf->get()) + rsp_off);
+  *rsp = {};
+  return rsp;
+}
+
+void
+platform_drv_virtio::
+put_err_word(uint32_t rsp_off) const
+{
+  {
+    std::lock_guard<std::mutex> lg(m_lock);
+    m_free_err_words.push_back(rsp_off);
+  }
+  m_err_word_cv.notify_one();
+}
+
+uint32_t
+platform_drv_virtio::
+get_resp_slot() const
+{
+  if (!m_resp_buf)
+    shim_err(ENODEV, "No response buffer for host call");
+
+  std::unique_lock<std::mutex> lk(m_lock);
+  m_slot_cv.wait(lk, [this] { return !m_free_slots.empty(); });
+  auto slot = m_free_slots.back();
+  m_free_slots.pop_back();
+  return slot;
+}
+
+void
+platform_drv_virtio::
+put_resp_slot(uint32_t slot) const
+{
+  {
+    std::lock_guard<std::mutex> lg(m_lock);
+    m_free_slots.push_back(slot);
+  }
+  m_slot_cv.notify_one();
+}
+
 void
 platform_drv_virtio::
 hcall(void *req, void *out_buf, size_t out_size) const
 {
-  // We have one response buffer, so can't really share across multiple requests.
-  std::lock_guard<std::mutex> lg(m_lock);
-  auto rsp_hdr = reinterpret_cast<amdxdna_ccmd_rsp*>(m_resp_buf->get());
+  // Each caller owns one slot of response buffer till the response is copied
+  // out, so hypercalls from different threads do not wait for each other.
+  auto slot = get_resp_slot();
+  auto rsp_off = slot * resp_buffer_size;
+  auto rsp_buf = static_cast<char*>(m_resp_buf->get()) + rsp_off;
+  auto rsp_hdr = reinterpret_cast<amdxdna_ccmd_rsp*>(rsp_buf);
+  rsp_hdr->base.len = 0;
   rsp_hdr->ret = 0;
 
+  auto r = reinterpret_cast<vdrm_ccmd_req*>(req);
+  r->rsp_off = rsp_off;
+
   auto sz = out_size;
   if (sz > resp_buffer_size)
     sz = resp_buffer_size;
 
-  hcall(req);
-  if (rsp_hdr->ret) {
-    auto r = reinterpret_cast<vdrm_ccmd_req*>(req);
-    shim_err(rsp_hdr->ret, "%s HCALL received bad response", hcall_cmd2name(r->cmd).c_str());
+  try {
+    hcall(req);
+    if (rsp_hdr->ret)
+      shim_err(rsp_hdr->ret, "%s HCALL received bad response", hcall_cmd2name(r->cmd).c_str());
+    // Host did not write to our slot. Older host does not always fill in
+    // the length, nothing to check there.
+    if (has_resp_slots() && !rsp_hdr->base.len)
+      shim_err(EIO, "%s HCALL received no response", hcall_cmd2name(r->cmd).c_str());
+    std::memcpy(out_buf, rsp_buf, sz);
+  } catch (...) {
+    put_resp_slot(slot);
+    throw;
   }
-  std::memcpy(out_buf, m_resp_buf->get(), sz);
+  put_resp_slot(slot);
 }
 
 void
@@ -528,6 +777,9 @@ create_ctx(create_ctx_arg& arg) const
   hcall(&req, &rsp, sizeof(rsp));
   arg.ctx_handle = rsp.handle;
   arg.syncobj_handle = AMDXDNA_INVALID_FENCE_HANDLE;
+
+  std::lock_guard<std::mutex> lg(m_exec_lock);
+  m_next_seq[arg.ctx_handle] = 0;
 }
 
 void
@@ -539,6 +791,9 @@ destroy_ctx(destroy_ctx_arg& arg) const
     .handle = arg.ctx_handle,
   };
   hcall(&req);
+
+  std::lock_guard<std::mutex> lg(m_exec_lock);
+  m_next_seq.erase(arg.ctx_handle);
 }
 
 std::pair<uint32_t, uint64_t>
@@ -560,13 +815,14 @@ host_bo_alloc(uint32_t type, size_t size, uint32_t res_id, uint64_t align) const
 
 void
 platform_drv_virtio::
-host_bo_free(uint32_t host_hdl) const
+host_bo_free(uint32_t host_hdl, uint32_t res_id) const
 {
   amdxdna_ccmd_destroy_bo_req req = {
     .hdr = { AMDXDNA_CCMD_DESTROY_BO, sizeof(req) },
     .handle = host_hdl,
   };
-  hcall(&req);
+  // Guest BO, if any, is closed once host has seen the request.
+  hcall_batched(&req, res_id);
 }
 
 void
@@ -630,8 +886,7 @@ destroy_bo(destroy_bo_arg& arg) const
   if (!delete_bo_info(id))
     return;
 
-  host_bo_free(arg.bo.handle);
-  drm_bo_free(dev_fd(), id);
+  host_bo_free(arg.bo.handle, id);
 }
 
 void
@@ -645,7 +900,20 @@ get_info(amdxdna_drm_get_info& arg) const
   if (arg.param == DRM_AMDXDNA_READ_AIE_REG)
     shim_err(EACCES, "get_info: DRM_AMDXDNA_READ_AIE_REG");
 
-  auto resp_buf = std::make_unique<response_buffer>(dev_fd(), arg.buffer_size);
+  auto ttl = get_info_ttl(arg.param);
+  auto key = std::make_pair(arg.param, arg.buffer_size);
+  if (ttl != std::chrono::steady_clock::duration::zero()) {
+    std::lock_guard<std::mutex> lg(m_info_lock);
+    auto it = m_info_cache.find(key);
+    if (it != m_info_cache.end() && std::chrono::steady_clock::now() < it->second.expire) {
+      auto& data = it->second.data;
+      std::memcpy(reinterpret_cast<char*>(arg.buffer), data.data(), data.size());
+      arg.buffer_size = data.size();
+      return;
+    }
+  }
+
+  auto resp_buf = get_info_buf(arg.buffer_size);
   std::memcpy(resp_buf->get(), reinterpret_cast<char*>(arg.buffer), arg.buffer_size);
   amdxdna_ccmd_get_info_req req = {
     .hdr = { AMDXDNA_CCMD_GET_INFO, sizeof(req) },
@@ -660,6 +928,18 @@ get_info(amdxdna_drm_get_info& arg) const
 
   std::memcpy(reinterpret_cast<char*>(arg.buffer), resp_buf->get(), rsp.size);
   arg.buffer_size = rsp.size;
+  put_info_buf(std::move(resp_buf));
+
+  if (ttl == std::chrono::steady_clock::duration::zero())
+    return;
+
+  auto now = std::chrono::steady_clock::now();
+  info_cache_entry e;
+  e.data.assign(reinterpret_cast<char*>(arg.buffer), reinterpret_cast<char*>(arg.buffer) + rsp.size);
+  e.expire = (ttl == std::chrono::steady_clock::duration::max()) ?
+    std::chrono::steady_clock::time_point::max() : now + ttl;
+  std::lock_guard<std::mutex> lg(m_info_lock);
+  m_info_cache[key] = std::move(e);
 }
 
 void
@@ -667,7 +947,7 @@ platform_drv_virtio::
 get_info_array(amdxdna_drm_get_array& arg) const
 {
   auto total_buf_size = arg.element_size * arg.num_element;
-  auto resp_buf = std::make_unique<response_buffer>(dev_fd(), total_buf_size);
+  auto resp_buf = get_info_buf(total_buf_size);
   std::memcpy(resp_buf->get(), reinterpret_cast<char*>(arg.buffer), total_buf_size);
 
   amdxdna_ccmd_get_info_req req = {
@@ -682,6 +962,40 @@ get_info_array(amdxdna_drm_get_array& arg) const
   std::memcpy(reinterpret_cast<char*>(arg.buffer), resp_buf->get(), total_buf_size);
   arg.element_size = rsp.size;
   arg.num_element = rsp.num_element;
+  put_info_buf(std::move(resp_buf));
+}
+
+std::unique_ptr<platform_drv_virtio::response_buffer>
+platform_drv_virtio::
+get_info_buf(size_t size) const
+{
+  {
+    // Smallest spare buffer which is big enough.
+    std::lock_guard<std::mutex> lg(m_info_lock);
+    auto best = m_info_bufs.end();
+    for (auto it = m_info_bufs.begin(); it != m_info_bufs.end(); ++it) {
+      if ((*it)->size() >= size && (best == m_info_bufs.end() || (*it)->size() < (*best)->size()))
+        best = it;
+    }
+    if (best != m_info_bufs.end()) {
+      auto buf = std::move(*best);
+      m_info_bufs.erase(best);
+      return buf;
+    }
+  }
+
+  // Round up to page size so that buffer can be reused by other queries.
+  auto sz = (size + resp_buffer_size - 1) / resp_buffer_size * resp_buffer_size;
+  return std::make_unique<response_buffer>(dev_fd(), sz ? sz : resp_buffer_size);
+}
+
+void
+platform_drv_virtio::
+put_info_buf(std::unique_ptr<response_buffer> buf) const
+{
+  std::lock_guard<std::mutex> lg(m_info_lock);
+  if (m_info_bufs.size() < max_info_bufs)
+    m_info_bufs.push_back(std::move(buf));
 }
 
 void
@@ -730,7 +1044,7 @@ config_ctx_cu_config(config_ctx_cu_config_arg& arg) const
   cu_conf_req->param_val_size = cu_conf_req->hdr.len - sizeof(amdxdna_ccmd_config_ctx_req);
   std::memcpy(cu_conf_param_buf.data() + sizeof(amdxdna_ccmd_config_ctx_req),
     arg.conf_buf.data(), arg.conf_buf.size());
-  hcall(cu_conf_req);
+  hcall_batched(cu_conf_req);
 }
 
 void
@@ -744,7 +1058,7 @@ config_ctx_debug_bo(config_ctx_debug_bo_arg& arg) const
       DRM_AMDXDNA_HWCTX_REMOVE_DBG_BUF : DRM_AMDXDNA_HWCTX_ASSIGN_DBG_BUF),
     .inline_param = arg.bo.handle,
   };
-  hcall(&req);
+  hcall_batched(&req);
 }
 
 void
@@ -777,11 +1091,25 @@ submit_cmd(submit_cmd_arg& arg) const
   req->arg_count = nargs;
   req->arg_offset = 1;
   int i = req->arg_offset;
-  for (auto& id : arg.arg_bos)
-    req->cmds_n_args[i++] = id.handle;
+  for (auto h : arg.arg_bos)
+    req->cmds_n_args[i++] = h;
+
+  if (!m_async_exec) {
+    hcall(req, &rsp, sizeof(rsp));
+    arg.seq = rsp.seq;
+    return;
+  }
 
-  hcall(req, &rsp, sizeof(rsp));
-  arg.seq = rsp.seq;
+  // Driver hands out seq one by one for each hw context, so seq is known
+  // before host sees the cmd. Failure is reported by next wait on the ctx.
+  std::lock_guard<std::mutex> lg(m_exec_lock);
+  auto& next_seq = m_next_seq[arg.ctx_handle];
+  req->hdr.cmd = AMDXDNA_CCMD_EXEC_CMD_ASYNC;
+  req->hdr.seqno = static_cast<uint32_t>(next_seq);
+  // Cmd should start right away, take batched ccmds along with it.
+  batch_locked(req);
+  flush_locked();
+  arg.seq = next_seq++;
 }
 
 void
@@ -794,7 +1122,27 @@ wait_cmd_ioctl(wait_cmd_arg& arg) const
     .timeout_nsec = shim_xdna::platform_drv::timeout_ms2abs_ns(arg.timeout_ms),
     .ctx_handle = arg.ctx_handle,
   };
-  hcall(&req);
+  if (!m_async_exec) {
+    hcall(&req);
+    return;
+  }
+
+  // Learn about failed async exec from an error word owned by this wait. It
+  // is not a response slot, so waiters do not hold others up.
+  uint32_t rsp_off;
+  auto rsp = get_err_word(rsp_off);
+  req.hdr.rsp_off = rsp_off;
+  int ret;
+  try {
+    hcall(&req);
+    ret = rsp->ret;
+  } catch (...) {
+    put_err_word(rsp_off);
+    throw;
+  }
+  put_err_word(rsp_off);
+  if (ret)
+    shim_err(ret, "%s HCALL received bad response", hcall_cmd2name(req.hdr.cmd).c_str());
 }
 
 void
@@ -815,6 +1163,8 @@ platform_drv_virtio::
 import_bo(import_bo_arg& bo_arg) const
 {
   auto fd = dev_fd();
+  // Guest BO closing may still be pending, do not let it alias the import.
+  flush();
   drm_prime_handle carg = {
     .handle = AMDXDNA_INVALID_BO_HANDLE,
     .flags = 0,
@@ -865,6 +1215,16 @@ sync_bo(sync_bo_arg& arg) const
     .offset = arg.offset,
     .size = arg.size,
   };
+  // Syncing to device only needs to reach host before the cmd using the BO,
+  // which flushes the batch. Host keeps the failure for next wait of the
+  // context, which is only read with async exec.
+  if (req.direction == SYNC_DIRECT_TO_DEVICE && m_async_exec &&
+      m_wire_version >= AMDXDNA_WIRE_FORMAT_ASYNC_SYNC_BO) {
+    req.hdr.cmd = AMDXDNA_CCMD_SYNC_BO_ASYNC;
+    hcall_batched(&req);
+    return;
+  }
+
   amdxdna_ccmd_sync_bo_rsp rsp = {};
   hcall(&req, &rsp, sizeof(rsp));
 }
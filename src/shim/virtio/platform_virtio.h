@@ -5,7 +5,14 @@
 #define PLAT_VIRTIO_H
 
 #include "../platform.h"
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
+
+struct amdxdna_ccmd_rsp;
 
 namespace shim_xdna {
 
@@ -20,6 +27,10 @@ public:
   void
   drv_close() const override;
 
+  // Send batched ccmds to host now.
+  void
+  flush() const;
+
 private:
 
   // Managing response buffer for hypercall.
@@ -35,6 +46,9 @@ private:
     void *
     get() const;
 
+    size_t
+    size() const;
+
   private:
     int m_dev_fd = -1;
     bo_id m_id;
@@ -42,10 +56,72 @@ private:
     void *m_ptr = nullptr;
   };
 
-  // Setup once and used forever
+  // Setup once and used forever. Split into slots of equal size, so that
+  // each outstanding hypercall has its own place for the response.
   mutable std::unique_ptr<response_buffer> m_resp_buf;
-  // Lock to serialize hypercall.
+  // Lock protecting free response slots.
   mutable std::mutex m_lock;
+  mutable std::condition_variable m_slot_cv;
+  mutable std::vector<uint32_t> m_free_slots;
+
+  // Serializing everything sent to host without waiting, so that batched
+  // ccmds and async exec reach host in order. Next seq of each hw context,
+  // mirroring host driver's.
+  mutable std::mutex m_exec_lock;
+  mutable std::map<uint32_t, uint64_t> m_next_seq;
+
+  // Stream of ccmds no one waits for, sent to host in one hypercall. Guest
+  // BOs are closed only after host has seen the request destroying them.
+  mutable std::vector<uint64_t> m_batch;
+  mutable std::vector<uint32_t> m_batch_bos;
+
+  void
+  batch_locked(const void *req) const;
+
+  void
+  flush_locked() const;
+
+  // Results of get_info queries which do not change often, keyed by
+  // (param, buffer size), and spare response buffers for the others.
+  struct info_cache_entry {
+    std::vector<char> data;
+    std::chrono::steady_clock::time_point expire;
+  };
+  mutable std::mutex m_info_lock;
+  mutable std::map<std::pair<uint32_t, uint32_t>, info_cache_entry> m_info_cache;
+  mutable std::vector<std::unique_ptr<response_buffer>> m_info_bufs;
+
+  std::unique_ptr<response_buffer>
+  get_info_buf(size_t size) const;
+
+  void
+  put_info_buf(std::unique_ptr<response_buffer> buf) const;
+
+  uint32_t
+  get_resp_slot() const;
+
+  void
+  put_resp_slot(uint32_t slot) const;
+
+  // Wire format version advertised by host, setup once in drv_open().
+  mutable uint32_t m_wire_version = 0;
+
+  bool
+  has_resp_slots() const;
+
+  // Set in drv_open() when async exec is enabled and host supports it. Error
+  // words start at m_err_off of response buffer, one for each wait in flight,
+  // so that a waiter never sees another waiter's result.
+  mutable bool m_async_exec = false;
+  mutable uint32_t m_err_off = 0;
+  mutable std::condition_variable m_err_word_cv;
+  mutable std::vector<uint32_t> m_free_err_words;
+
+  amdxdna_ccmd_rsp *
+  get_err_word(uint32_t& rsp_off) const;
+
+  void
+  put_err_word(uint32_t rsp_off) const;
 
   // indicate if host memory is used for shared memory
   // Setup once and used forever
@@ -57,6 +133,9 @@ private:
   void
   hcall(void *req) const;
 
+  void
+  hcall_batched(void *req, uint32_t res_id = AMDXDNA_INVALID_BO_HANDLE) const;
+
   void
   create_ctx(create_ctx_arg& arg) const override;
 
@@ -67,7 +146,7 @@ private:
   host_bo_alloc(uint32_t type, size_t size, uint32_t res_id, uint64_t align) const;
 
   void
-  host_bo_free(uint32_t host_hdl) const;
+  host_bo_free(uint32_t host_hdl, uint32_t res_id = AMDXDNA_INVALID_BO_HANDLE) const;
 
   void
   create_bo(bo_info& arg) const override;
@@ -23,6 +23,26 @@
  */
 #define AMDXDNA_MAX_HWCTX_PER_CTX 32
 
+/*
+ * Wire format versions, advertised by host in vaccel_drm_capset. Guest only
+ * uses a feature when host advertises a version at least as new as it.
+ *
+ * RSP_SLOTS: every response, error ones included, is written at the rsp_off
+ * of its request, so guest may keep several requests with response in flight.
+ */
+#define AMDXDNA_WIRE_FORMAT_BASE        1
+#define AMDXDNA_WIRE_FORMAT_RSP_SLOTS   2
+/*
+ * ASYNC_EXEC: host accepts EXEC_CMD_ASYNC, and reports its failure at the
+ * rsp_off of every later WAIT_CMD of the same hw context.
+ */
+#define AMDXDNA_WIRE_FORMAT_ASYNC_EXEC  3
+/*
+ * ASYNC_SYNC_BO: host accepts SYNC_BO_ASYNC, and reports its failure at the
+ * rsp_off of the next WAIT_CMD of the same context.
+ */
+#define AMDXDNA_WIRE_FORMAT_ASYNC_SYNC_BO 4
+
 enum amdxdna_ccmd {
     AMDXDNA_CCMD_NOP = 1,
     AMDXDNA_CCMD_INIT,
@@ -36,6 +56,8 @@ enum amdxdna_ccmd {
     AMDXDNA_CCMD_GET_INFO,
     AMDXDNA_CCMD_READ_SYSFS,
     AMDXDNA_CCMD_SYNC_BO,
+    AMDXDNA_CCMD_EXEC_CMD_ASYNC,
+    AMDXDNA_CCMD_SYNC_BO_ASYNC,
 };
 
 #ifdef __cplusplus
@@ -165,6 +187,27 @@ struct amdxdna_ccmd_exec_cmd_rsp {
     uint64_t seq;
 };
 
+/*
+ * AMDXDNA_CCMD_EXEC_CMD_ASYNC
+ *
+ * Same as EXEC_CMD, but there is no response. Guest assigns seq itself,
+ * lower 32 bits of it is passed in hdr.seqno for host to verify. Once an
+ * async exec fails on a hw context, all later async execs on it are dropped
+ * and WAIT_CMD on it fails.
+ */
+struct amdxdna_ccmd_exec_cmd_async_req {
+    struct vdrm_ccmd_req hdr;
+    uint32_t ctx_handle;
+    uint32_t type;
+    uint32_t cmd_count;
+    uint32_t arg_count;
+    uint32_t arg_offset; /* number of dwords from the cmds_n_args[0] */
+    uint32_t cmds_n_args[];
+};
+DEFINE_CAST(vdrm_ccmd_req, amdxdna_ccmd_exec_cmd_async_req)
+static_assert(sizeof(struct amdxdna_ccmd_exec_cmd_async_req) ==
+              sizeof(struct amdxdna_ccmd_exec_cmd_req), "bug");
+
 /*
  * AMDXDNA_CCMD_WAIT_CMD
  */
@@ -222,6 +265,23 @@ DEFINE_CAST(vdrm_ccmd_req, amdxdna_ccmd_sync_bo_req)
 struct amdxdna_ccmd_sync_bo_rsp {
     struct amdxdna_ccmd_rsp hdr;
 };
+
+/*
+ * AMDXDNA_CCMD_SYNC_BO_ASYNC
+ *
+ * Same as SYNC_BO, but there is no response. Its failure fails the next
+ * WAIT_CMD on the context.
+ */
+struct amdxdna_ccmd_sync_bo_async_req {
+    struct vdrm_ccmd_req hdr;
+    uint32_t handle;
+    uint32_t direction;
+    uint64_t offset;
+    uint64_t size;
+};
+DEFINE_CAST(vdrm_ccmd_req, amdxdna_ccmd_sync_bo_async_req)
+static_assert(sizeof(struct amdxdna_ccmd_sync_bo_async_req) ==
+              sizeof(struct amdxdna_ccmd_sync_bo_req), "bug");
 DEFINE_CAST(vdrm_ccmd_req, amdxdna_ccmd_read_sysfs_req)
 
 struct amdxdna_ccmd_read_sysfs_rsp {
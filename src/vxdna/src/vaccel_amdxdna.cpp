@@ -27,6 +27,7 @@
 #include <sys/stat.h>
 #include <system_error>
 #include <thread>
+#include <time.h>
 #include <vector>
 
 #include <drm/drm.h>
@@ -874,40 +875,264 @@ vxdna_bo::
     }
 }
 
+vxdna_fence_reactor::
+vxdna_fence_reactor(int fd, void *cookie, uint32_t ctx_id, write_fence_fn write_fence)
+    : m_fd(fd)
+    , m_cookie(cookie)
+    , m_ctx_id(ctx_id)
+    , m_write_fence(write_fence)
+{
+    struct drm_syncobj_create create_arg = {};
+    int ret = ioctl(m_fd, DRM_IOCTL_SYNCOBJ_CREATE, &create_arg);
+    if (ret)
+        VACCEL_THROW_MSG(-errno, "Create wakeup syncobj failed ret %d, errno %d, %s",
+                         ret, errno, strerror(errno));
+    m_wake_syncobj = create_arg.handle;
+
+    auto rollback_wake_syncobj = [&]() {
+        struct drm_syncobj_destroy sync_arg = {};
+        sync_arg.handle = m_wake_syncobj;
+        ioctl(m_fd, DRM_IOCTL_SYNCOBJ_DESTROY, &sync_arg);
+    };
+
+    try {
+        m_thread = std::thread([this]() { run(); });
+    } catch (const std::system_error &e) {
+        rollback_wake_syncobj();
+        /*
+         * pthread_create failure is reported as std::system_error; map the
+         * errno (typically EAGAIN under RLIMIT_NPROC / pids.max) so the guest
+         * can back off and retry instead of getting a generic -EIO.
+         */
+        int err = EAGAIN;
+        if (e.code().category() == std::system_category())
+            err = e.code().value();
+        if (err <= 0)
+            err = EAGAIN;
+        VACCEL_THROW_MSG(-err,
+                         "vxdna_fence_reactor ctor: failed to start reactor thread: %s",
+                         e.what());
+    } catch (const std::bad_alloc &) {
+        rollback_wake_syncobj();
+        VACCEL_THROW_MSG(-ENOMEM,
+                         "vxdna_fence_reactor ctor: failed to start reactor thread");
+    } catch (const std::exception &e) {
+        rollback_wake_syncobj();
+        VACCEL_THROW_MSG(-EIO,
+                         "vxdna_fence_reactor ctor: failed to start reactor thread: %s",
+                         e.what());
+    } catch (...) {
+        rollback_wake_syncobj();
+        VACCEL_THROW_MSG(-EIO,
+                         "vxdna_fence_reactor ctor: failed to start reactor thread "
+                         "(unknown exception)");
+    }
+}
+
+vxdna_fence_reactor::
+~vxdna_fence_reactor() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stop = true;
+        kick();
+    }
+    m_cv.notify_all();
+
+    if (m_thread.joinable())
+        m_thread.join();
+
+    struct drm_syncobj_destroy arg = {};
+    arg.handle = m_wake_syncobj;
+    auto ret = ioctl(m_fd, DRM_IOCTL_SYNCOBJ_DESTROY, &arg);
+    if (ret)
+        vxdna_err("Destroy wakeup syncobj failed ret %d", ret);
+}
+
 void
-vxdna_context::vxdna_hwctx::
-poll_and_retire_pending(std::vector<std::shared_ptr<vaccel_fence>> &&copy_pending_fences)
+vxdna_fence_reactor::
+kick()
+{
+    // Called with m_lock held, so wakeup points are signaled in order.
+    struct drm_syncobj_timeline_array arg = {};
+    uint64_t point = ++m_wake_point;
+    arg.handles = reinterpret_cast<uintptr_t>(&m_wake_syncobj);
+    arg.points = reinterpret_cast<uintptr_t>(&point);
+    arg.count_handles = 1;
+    auto ret = ioctl(m_fd, DRM_IOCTL_SYNCOBJ_TIMELINE_SIGNAL, &arg);
+    if (ret)
+        vxdna_err("vxdna_fence_reactor::kick: signal failed ret %d, errno %d, %s",
+                  ret, errno, strerror(errno));
+}
+
+void
+vxdna_fence_reactor::
+add(std::shared_ptr<vaccel_fence> fence)
 {
-    for (auto &fence : copy_pending_fences) {
-        // Check stop flag before processing each fence
-        if (m_stop_polling.load(std::memory_order_relaxed))
-            break;
+    std::lock_guard<std::mutex> lock(m_lock);
+    /*
+     * Refuse to grow the pending queue past MAX_PENDING_FENCES. Throwing
+     * surfaces -ENOSPC up through vaccel_error_wrap("vaccel_submit_fence")
+     * so QEMU can fail the virtio command.
+     */
+    if (m_pending.size() >= MAX_PENDING_FENCES)
+        VACCEL_THROW_MSG(-ENOSPC,
+                         "fence reactor: ctx %u ring %u pending queue full "
+                         "(%zu/%zu); fence_id=%lu rejected",
+                         m_ctx_id, fence->get_ring_idx(), m_pending.size(),
+                         MAX_PENDING_FENCES, static_cast<unsigned long>(fence->get_id()));
+    m_pending.push_back(std::move(fence));
+    kick();
+    m_cv.notify_all();
+}
+
+void
+vxdna_fence_reactor::
+remove(uint32_t ring_idx)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+                                   [ring_idx](const std::shared_ptr<vaccel_fence> &f) {
+                                       return f->get_ring_idx() == ring_idx;
+                                   }),
+                    m_pending.end());
+    auto generation = ++m_generation;
+    kick();
+    m_cv.notify_all();
+
+    // The reactor thread does not wait on its own.
+    if (std::this_thread::get_id() == m_thread.get_id())
+        return;
+    m_cv.wait(lock, [this, generation] {
+        return m_stop || m_seen_generation >= generation;
+    });
+}
+
+void
+vxdna_fence_reactor::
+run()
+{
+    std::vector<std::shared_ptr<vaccel_fence>> fences;
+    std::vector<std::shared_ptr<vaccel_fence>> retired;
+    std::vector<uint32_t> handles;
+    std::vector<uint64_t> points;
+    std::vector<uint64_t> signaled;
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_stop)
+                break;
+            // Syncobjs of removed hw contexts are not in the new wait set.
+            m_seen_generation = m_generation;
+            fences = m_pending;
+            handles.assign(1, m_wake_syncobj);
+            points.assign(1, m_wake_point + 1);
+        }
+        m_cv.notify_all();
+
+        // Only the lowest pending point of each syncobj matters to wait-any.
+        int64_t timeout_nsec = std::numeric_limits<int64_t>::max();
+        for (auto &fence : fences) {
+            auto it = std::find(handles.begin() + 1, handles.end(), fence->get_syncobj_handle());
+            if (it == handles.end()) {
+                handles.push_back(fence->get_syncobj_handle());
+                points.push_back(fence->get_sync_point());
+            } else {
+                auto &point = points[it - handles.begin()];
+                point = std::min(point, fence->get_sync_point());
+            }
+            timeout_nsec = std::min(timeout_nsec, fence->get_timeout_nsec());
+        }
 
-        uint64_t fence_sync_point = fence->get_sync_point();
         drm_syncobj_timeline_wait arg = {};
-        arg.handles = reinterpret_cast<uintptr_t>(&m_syncobj_handle);
-        arg.points = reinterpret_cast<uintptr_t>(&fence_sync_point);
-        arg.timeout_nsec = fence->get_timeout_nsec();
-        arg.count_handles = 1;
-        /* Keep waiting even if not submitted yet */
+        arg.handles = reinterpret_cast<uintptr_t>(handles.data());
+        arg.points = reinterpret_cast<uintptr_t>(points.data());
+        arg.timeout_nsec = timeout_nsec;
+        arg.count_handles = handles.size();
+        /* Keep waiting even if not submitted yet, wake up on first signaled */
         arg.flags = DRM_SYNCOBJ_WAIT_FLAGS_WAIT_FOR_SUBMIT;
-        auto ret = ioctl(m_ctx_fd, DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT, &arg);
-        if (ret)
-            vxdna_err("vxdna_hwctx::poll_and_retire_pending: Wait for fence failed ret %d, errno %d, %s, expect timeout: %ld",
-                      ret, errno, strerror(errno), fence->get_timeout_nsec());
+        auto ret = ioctl(m_fd, DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT, &arg);
+        // Interrupted wait says nothing about the fences, just wait again.
+        if (ret && errno == EINTR)
+            continue;
+        bool failed = ret && errno != ETIME;
+        if (failed)
+            vxdna_err("vxdna_fence_reactor::run: Wait for %zu fences failed ret %d, errno %d, %s",
+                      fences.size(), ret, errno, strerror(errno));
+
+        if (fences.empty()) {
+            if (failed) {
+                // Do not spin on a broken FD, wait for something to do. A
+                // remove() waits for the new generation to be seen, wake up
+                // for it too.
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_cv.wait(lock, [this] {
+                    return m_stop || !m_pending.empty() || m_generation != m_seen_generation;
+                });
+            }
+            continue;
+        }
+
+        // Read signaled point of every syncobj in the wait set at once.
+        signaled.assign(handles.size(), 0);
+        if (!failed) {
+            struct drm_syncobj_timeline_array query = {};
+            query.handles = reinterpret_cast<uintptr_t>(handles.data());
+            query.points = reinterpret_cast<uintptr_t>(signaled.data());
+            query.count_handles = handles.size();
+            ret = ioctl(m_fd, DRM_IOCTL_SYNCOBJ_QUERY, &query);
+            if (ret) {
+                vxdna_err("vxdna_fence_reactor::run: Query %zu syncobjs failed ret %d, errno %d, %s",
+                          handles.size(), ret, errno, strerror(errno));
+                failed = true;
+            }
+        }
+
+        struct timespec ts = {};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        int64_t now = static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+
+        /*
+         * Retire every fence which is signaled or timed out in one pass. A
+         * failed wait retires the fences it covered, as a failed per-fence
+         * wait used to. Fences added since the wait set was built are only
+         * checked against syncobjs which were part of it.
+         */
+        retired.clear();
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto it = std::remove_if(m_pending.begin(), m_pending.end(),
+                [&](const std::shared_ptr<vaccel_fence> &fence) {
+                    auto h = std::find(handles.begin() + 1, handles.end(),
+                                       fence->get_syncobj_handle());
+                    if (h == handles.end())
+                        return false;
+                    if (!failed &&
+                        signaled[h - handles.begin()] < fence->get_sync_point() &&
+                        now < fence->get_timeout_nsec())
+                        return false;
+                    retired.push_back(fence);
+                    return true;
+                });
+            m_pending.erase(it, m_pending.end());
+        }
+
         // Fence is retired, write fence callback (signal on the guest ring).
-        m_write_fence_callback(m_cookie, m_ctx_id, hwctx_ring_idx(m_hwctx_handle),
-                               fence->get_id());
+        for (auto &fence : retired)
+            m_write_fence(m_cookie, m_ctx_id, fence->get_ring_idx(), fence->get_id());
     }
 }
 
 vxdna_context::vxdna_hwctx::
 vxdna_hwctx(const vxdna_context &ctx,
-     const struct amdxdna_ccmd_create_ctx_req *req)
+     const struct amdxdna_ccmd_create_ctx_req *req,
+     vxdna_fence_reactor &reactor)
     : m_cookie(ctx.get_cookie())
     , m_write_fence_callback(ctx.get_callbacks()->write_context_fence)
     , m_ctx_fd(ctx.get_fd())
     , m_ctx_id(ctx.get_id())
+    , m_reactor(reactor)
 {
     // Validate callback FIRST, before any resource allocation
     if (!m_write_fence_callback)
@@ -931,99 +1156,16 @@ vxdna_hwctx(const vxdna_context &ctx,
 
     vxdna_dbg("Create hw context: ctx_fd=%d, max_opc=%u, num_tiles=%u, mem_size=%u",
               m_ctx_fd, req->max_opc, req->num_tiles, req->mem_size);
-
-    // Start polling thread to retire fences
-    m_stop_polling.store(false, std::memory_order_relaxed);
-    auto rollback_created_hwctx = [&]() {
-        /*
-         * Roll back the kernel hwctx + syncobj acquired above before we
-         * hand the failure back to the guest.  Member subobjects unwind
-         * on their own when this constructor throws (the dtor itself is
-         * not invoked on a partially-constructed object), but the DRM
-         * handles are external state and must be released here.
-         */
-        struct drm_syncobj_destroy sync_arg = {};
-        sync_arg.handle = m_syncobj_handle;
-        ioctl(m_ctx_fd, DRM_IOCTL_SYNCOBJ_DESTROY, &sync_arg);
-
-        struct amdxdna_drm_destroy_hwctx hwctx_arg = {};
-        hwctx_arg.handle = m_hwctx_handle;
-        ioctl(m_ctx_fd, DRM_IOCTL_AMDXDNA_DESTROY_HWCTX, &hwctx_arg);
-    };
-
-    try {
-        m_polling_thread = std::thread([this]() {
-            while (!m_stop_polling.load(std::memory_order_relaxed)) {
-                std::vector<std::shared_ptr<vaccel_fence>> tmp_pending_fences;
-                {
-                    std::unique_lock<std::mutex> lock(m_fences_lock);
-                    m_cv.wait(lock, [this] {
-                        return m_stop_polling.load(std::memory_order_relaxed) || !m_pending_fences.empty();
-                    });
-                    if (m_stop_polling.load(std::memory_order_relaxed))
-                        break;
-                    tmp_pending_fences.swap(m_pending_fences);
-                }
-                poll_and_retire_pending(std::move(tmp_pending_fences));
-            }
-        });
-    } catch (const std::system_error &e) {
-        rollback_created_hwctx();
-        /*
-         * pthread_create failure is reported as std::system_error; map the
-         * errno (typically EAGAIN under RLIMIT_NPROC / pids.max) so the guest
-         * can back off and retry instead of getting a generic -EIO.
-         */
-        int err = EAGAIN;
-        if (e.code().category() == std::system_category())
-            err = e.code().value();
-        if (err <= 0)
-            err = EAGAIN;
-        VACCEL_THROW_MSG(-err,
-                         "vxdna_hwctx ctor: failed to start polling thread: %s",
-                         e.what());
-    } catch (const std::bad_alloc &) {
-        rollback_created_hwctx();
-        VACCEL_THROW_MSG(-ENOMEM,
-                         "vxdna_hwctx ctor: failed to start polling thread");
-    } catch (const std::exception &e) {
-        rollback_created_hwctx();
-        VACCEL_THROW_MSG(-EIO,
-                         "vxdna_hwctx ctor: failed to start polling thread: %s",
-                         e.what());
-    } catch (...) {
-        rollback_created_hwctx();
-        VACCEL_THROW_MSG(-EIO,
-                         "vxdna_hwctx ctor: failed to start polling thread "
-                         "(unknown exception)");
-    }
 }
 
 vxdna_context::vxdna_hwctx::
 ~vxdna_hwctx() noexcept
 {
     vxdna_dbg("HW context finishing: ctx_id=%u, hwctx_handle=%u", m_ctx_id, m_hwctx_handle);
-    // Signal polling thread to stop (wakes it if parked in m_cv.wait()).
-    // Set the flag under m_fences_lock so the store cannot land in the window
-    // between the waiter's predicate check and its sleep, which would otherwise
-    // lose the wakeup and hang the join() below.
-    {
-        std::lock_guard<std::mutex> lock(m_fences_lock);
-        m_stop_polling.store(true, std::memory_order_relaxed);
-    }
-    m_cv.notify_all();
 
     /*
-     * Destroy the hardware context BEFORE joining the polling thread.
-     *
-     * The polling thread can be parked in a blocking
-     * DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT on a job that will never complete on its
-     * own (e.g. the guest OOM'd before its command finished). The stop flag is
-     * not observed inside that ioctl, so joining first would deadlock: the wait
-     * only returns once the fence signals, but the fence is only signalled when
-     * the kernel tears down this hwctx. DESTROY_HWCTX aborts/completes the
-     * in-flight jobs and signals their fences, which lets the wait return so the
-     * loop can observe the stop flag and exit.
+     * Destroy the hardware context first, it aborts/completes the in-flight
+     * jobs and signals their fences.
      */
     if (m_hwctx_handle != AMDXDNA_INVALID_CTX_HANDLE) {
         struct amdxdna_drm_destroy_hwctx arg = {};
@@ -1033,13 +1175,11 @@ vxdna_context::vxdna_hwctx::
             vxdna_err("Close hw context failed ret %d", ret);
     }
 
-    // Now the syncobj wait can return; wait for the polling thread to finish.
-    if (m_polling_thread.joinable()) {
-        m_polling_thread.join();
-    }
+    // Drop our fences, reactor stops waiting on the syncobj once this returns.
+    m_reactor.remove(hwctx_ring_idx(m_hwctx_handle));
     m_hwctx_handle = AMDXDNA_INVALID_CTX_HANDLE;
 
-    // Safe to destroy the syncobj once the polling thread is no longer waiting.
+    // Safe to destroy the syncobj once the reactor is no longer waiting.
     if (m_syncobj_handle != AMDXDNA_INVALID_FENCE_HANDLE) {
         struct drm_syncobj_destroy arg = {};
         arg.handle = m_syncobj_handle;
@@ -1092,6 +1232,29 @@ exec_cmd(const struct amdxdna_ccmd_exec_cmd_req *req)
     return args.seq;
 }
 
+void
+vxdna_context::vxdna_hwctx::
+exec_cmd_async(const struct amdxdna_ccmd_exec_cmd_async_req *req)
+{
+    // Seq of guest is off from now on, drop everything after a failure.
+    if (m_async_error)
+        VACCEL_THROW_MSG(m_async_error.load(), "Async exec dropped on hwctx %u", m_hwctx_handle);
+
+    uint64_t seq;
+    try {
+        seq = exec_cmd(reinterpret_cast<const struct amdxdna_ccmd_exec_cmd_req *>(req));
+    } catch (const vaccel_error& e) {
+        m_async_error = e.code() ? e.code() : -EIO;
+        throw;
+    }
+
+    if (static_cast<uint32_t>(seq) != req->hdr.seqno) {
+        m_async_error = -EIO;
+        VACCEL_THROW_MSG(-EIO, "Async exec seq mismatch on hwctx %u, guest %u, host %lu",
+                         m_hwctx_handle, req->hdr.seqno, static_cast<unsigned long>(seq));
+    }
+}
+
 void
 vxdna_context::vxdna_hwctx::
 submit_fence(uint64_t fence_id)
@@ -1103,29 +1266,11 @@ submit_fence(uint64_t fence_id)
             // Fence is not submitted yet, invoke callback outside lock
             immediate_callback = true;
         } else {
-            /*
-             * Refuse to grow the pending queue past MAX_PENDING_FENCES.
-             * The polling thread can only block on one syncobj_wait at a
-             * time, so a guest that submits a fence with a never-reached
-             * sync point pins the head and lets the queue grow on every
-             * subsequent submit.  Throwing surfaces -ENOSPC up through
-             * vaccel_error_wrap("vaccel_submit_fence") so QEMU can fail
-             * the virtio command; m_has_sync_point stays asserted so the
-             * next submit_fence retries cleanly once the queue drains.
-             */
-            if (m_pending_fences.size() >= MAX_PENDING_FENCES)
-                VACCEL_THROW_MSG(-ENOSPC,
-                                 "submit_fence: ctx %u hwctx %u pending queue full "
-                                 "(%zu/%zu); fence_id=%lu rejected",
-                                 m_ctx_id, m_hwctx_handle,
-                                 m_pending_fences.size(),
-                                 MAX_PENDING_FENCES,
-                                 static_cast<unsigned long>(fence_id));
-
+            // m_has_sync_point stays asserted if the reactor refuses the
+            // fence, so the next submit_fence retries cleanly.
             auto fence = std::make_shared<vaccel_fence>(fence_id, m_sync_point, m_syncobj_handle, hwctx_ring_idx(m_hwctx_handle), m_timeout_nsec);
-            m_pending_fences.push_back(std::move(fence));
+            m_reactor.add(std::move(fence));
             m_has_sync_point = false;
-            m_cv.notify_one();
         }
     }
     // Invoke callback outside lock to avoid deadlock
@@ -1245,11 +1390,11 @@ void
 vxdna_context::
 create_hwctx(const struct amdxdna_ccmd_create_ctx_req *req)
 {
-    // Construct outside the lock (CREATE_HWCTX ioctl and polling-thread start
-    // can block). The slot index is the virtio ring index derived from the
-    // driver ctx id and doubles as the allocator: a taken slot means either the
-    // cap is reached or two ctx ids collide under hwctx_ring_idx().
-    auto hwctx = std::make_shared<vxdna_hwctx>(*this, req);
+    // Construct outside the lock (CREATE_HWCTX ioctl can block). The slot
+    // index is the virtio ring index derived from the driver ctx id and
+    // doubles as the allocator: a taken slot means either the cap is reached
+    // or two ctx ids collide under hwctx_ring_idx().
+    auto hwctx = std::make_shared<vxdna_hwctx>(*this, req, get_fence_reactor());
     uint32_t ring_idx = hwctx_ring_idx(hwctx->get_handle());
     {
         std::lock_guard<std::mutex> lock(m_hwctx_lock);
@@ -1280,7 +1425,7 @@ remove_hwctx(uint32_t handle)
 {
     uint32_t ring_idx = hwctx_ring_idx(handle);
     // Move the entry out under the lock, then let it destruct outside the lock
-    // (~vxdna_hwctx joins the polling thread).
+    // (~vxdna_hwctx waits for the fence reactor to drop its syncobj).
     std::shared_ptr<vxdna_hwctx> old;
     {
         std::lock_guard<std::mutex> lock(m_hwctx_lock);
@@ -1294,6 +1439,18 @@ remove_hwctx(uint32_t handle)
     }
 }
 
+vxdna_fence_reactor &
+vxdna_context::
+get_fence_reactor()
+{
+    // Started with the first hw context, stopped with this context.
+    std::lock_guard<std::mutex> lock(m_hwctx_lock);
+    if (!m_fence_reactor)
+        m_fence_reactor = std::make_unique<vxdna_fence_reactor>(
+            get_fd(), get_cookie(), get_id(), get_callbacks()->write_context_fence);
+    return *m_fence_reactor;
+}
+
 void
 vxdna_context::
 config_hwctx(const struct amdxdna_ccmd_config_ctx_req *req)
@@ -1335,6 +1492,16 @@ exec_cmd(const struct amdxdna_ccmd_exec_cmd_req *req)
     write_rsp(&rsp, sizeof(rsp), req->hdr.rsp_off);
 }
 
+void
+vxdna_context::
+exec_cmd_async(const struct amdxdna_ccmd_exec_cmd_async_req *req)
+{
+    auto hwctx = find_hwctx_by_handle(req->ctx_handle);
+    if (!hwctx)
+        VACCEL_THROW_MSG(-EINVAL, "HW context not found handle %u", req->ctx_handle);
+    hwctx->exec_cmd_async(req);
+}
+
 void
 vxdna_context::
 wait_cmd(const struct amdxdna_ccmd_wait_cmd_req *req)
@@ -1342,32 +1509,59 @@ wait_cmd(const struct amdxdna_ccmd_wait_cmd_req *req)
     auto hwctx = find_hwctx_by_handle(req->ctx_handle);
     if (!hwctx)
         VACCEL_THROW_MSG(-EINVAL, "HW context not found handle %u", req->ctx_handle);
+    // Fail the wait without a sync point, so its fence is signaled right away.
+    // Sync_bo error is reported once, hw context error sticks with it.
+    auto err = m_async_error.exchange(0);
+    if (err)
+        VACCEL_THROW_MSG(err, "Async sync_bo failed on ctx %u, err %d", get_id(), err);
+    err = hwctx->get_async_error();
+    if (err)
+        VACCEL_THROW_MSG(err, "Async exec failed on hwctx %u, err %d", req->ctx_handle, err);
     hwctx->set_sync_point(req->seq, req->timeout_nsec);
-    write_err_rsp(0); // Success
+    write_err_rsp(0, req->hdr.rsp_off); // Success
 }
 
 void
 vxdna_context::
-sync_bo(const struct amdxdna_ccmd_sync_bo_req *req)
+sync_bo(uint32_t handle, uint32_t direction, uint64_t offset, uint64_t size)
 {
     // The guest BO handle is this context's own host GEM handle (each context
     // has its own DRM fd / GEM namespace). Validate the BO belongs to this
     // context before issuing the driver ioctl on this context's fd.
-    auto bo = m_bo_table.lookup(req->handle);
+    auto bo = m_bo_table.lookup(handle);
     if (!bo)
         VACCEL_THROW_MSG(-EINVAL, "sync_bo: BO %u not found in ctx %u",
-                         req->handle, get_id());
+                         handle, get_id());
 
     struct amdxdna_drm_sync_bo arg = {};
-    arg.handle = req->handle;
-    arg.direction = req->direction;
-    arg.offset = req->offset;
-    arg.size = req->size;
+    arg.handle = handle;
+    arg.direction = direction;
+    arg.offset = offset;
+    arg.size = size;
     if (ioctl(get_fd(), DRM_IOCTL_AMDXDNA_SYNC_BO, &arg))
         VACCEL_THROW_MSG(-errno, "sync_bo ioctl failed for BO %u, errno %d",
-                         req->handle, errno);
+                         handle, errno);
+}
 
-    write_err_rsp(0); // Success
+void
+vxdna_context::
+sync_bo(const struct amdxdna_ccmd_sync_bo_req *req)
+{
+    sync_bo(req->handle, req->direction, req->offset, req->size);
+    write_err_rsp(0, req->hdr.rsp_off); // Success
+}
+
+void
+vxdna_context::
+sync_bo_async(const struct amdxdna_ccmd_sync_bo_async_req *req)
+{
+    try {
+        sync_bo(req->handle, req->direction, req->offset, req->size);
+    } catch (const vaccel_error& e) {
+        int expected = 0;
+        m_async_error.compare_exchange_strong(expected, e.code() ? e.code() : -EIO);
+        throw;
+    }
 }
 
 void
@@ -1526,7 +1720,7 @@ read_sysfs(const struct amdxdna_ccmd_read_sysfs_req *req)
 
 void
 vxdna_context::
-write_err_rsp(int err)
+write_err_rsp(int err, uint32_t rsp_off)
 {
     auto resp_res = get_resp_res();
     if (!resp_res) {
@@ -1537,7 +1731,7 @@ write_err_rsp(int err)
     struct amdxdna_ccmd_rsp rsp = {};
     rsp.ret = err;
     rsp.base.len = sizeof(rsp);
-    resp_res->write(0, &rsp, sizeof(rsp));
+    resp_res->write(rsp_off, &rsp, sizeof(rsp));
 }
 
 void
@@ -1715,7 +1909,7 @@ vxdna_ccmd_create_bo([[maybe_unused]] vxdna &device, const std::shared_ptr<vxdna
                      const void *hdr)
 {
     auto *req = static_cast<const struct amdxdna_ccmd_create_bo_req *>(hdr);
-    vxdna_ccmd_error_wrap(ctx, [&]() {
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
         ctx->create_bo(req);
     });
 }
@@ -1726,7 +1920,7 @@ vxdna_ccmd_destroy_bo([[maybe_unused]] vxdna &device, const std::shared_ptr<vxdn
 {
     auto *req = static_cast<const struct amdxdna_ccmd_destroy_bo_req *>(hdr);
 
-    vxdna_ccmd_error_wrap(ctx, [&]() {
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
         ctx->remove_bo(req->handle);
     });
 }
@@ -1737,7 +1931,7 @@ vxdna_ccmd_create_ctx([[maybe_unused]] vxdna &device, const std::shared_ptr<vxdn
 {
     auto *req = static_cast<const struct amdxdna_ccmd_create_ctx_req *>(hdr);
 
-    vxdna_ccmd_error_wrap(ctx, [&]() {
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
         ctx->create_hwctx(req);
     });
 }
@@ -1748,7 +1942,7 @@ vxdna_ccmd_destroy_ctx([[maybe_unused]] vxdna &device, const std::shared_ptr<vxd
 {
     auto *req = static_cast<const struct amdxdna_ccmd_destroy_ctx_req *>(hdr);
 
-    vxdna_ccmd_error_wrap(ctx, [&]() {
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
         ctx->remove_hwctx(req->handle);
     });
 }
@@ -1759,7 +1953,7 @@ vxdna_ccmd_config_ctx([[maybe_unused]] vxdna &device, const std::shared_ptr<vxdn
 {
     auto *req = static_cast<const struct amdxdna_ccmd_config_ctx_req *>(hdr);
 
-    vxdna_ccmd_error_wrap(ctx, [&]() {
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
         ctx->config_hwctx(req);
     });
 }
@@ -1770,18 +1964,30 @@ vxdna_ccmd_exec_cmd([[maybe_unused]] vxdna &device, const std::shared_ptr<vxdna_
 {
     auto *req = static_cast<const struct amdxdna_ccmd_exec_cmd_req *>(hdr);
 
-    vxdna_ccmd_error_wrap(ctx, [&]() {
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
         ctx->exec_cmd(req);
     });
 }
 
+static void
+vxdna_ccmd_exec_cmd_async([[maybe_unused]] vxdna &device, const std::shared_ptr<vxdna_context>& ctx,
+                          const void *hdr)
+{
+    auto *req = static_cast<const struct amdxdna_ccmd_exec_cmd_async_req *>(hdr);
+
+    // Nobody reads the response, error is reported by next WAIT_CMD.
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
+        ctx->exec_cmd_async(req);
+    });
+}
+
 static void
 vxdna_ccmd_wait_cmd([[maybe_unused]] vxdna &device, const std::shared_ptr<vxdna_context>& ctx,
                     const void *hdr)
 {
     auto *req = static_cast<const struct amdxdna_ccmd_wait_cmd_req *>(hdr);
 
-    vxdna_ccmd_error_wrap(ctx, [&]() {
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
         ctx->wait_cmd(req);
     });
 }
@@ -1791,7 +1997,7 @@ vxdna_ccmd_get_info([[maybe_unused]] vxdna &device, const std::shared_ptr<vxdna_
                     const void *hdr)
 {
     auto *req = static_cast<const struct amdxdna_ccmd_get_info_req *>(hdr);
-    vxdna_ccmd_error_wrap(ctx, [&]() {
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
         ctx->get_info(req);
     });
 }
@@ -1801,7 +2007,7 @@ vxdna_ccmd_read_sysfs([[maybe_unused]] vxdna &device, const std::shared_ptr<vxdn
                       const void *hdr)
 {
     auto *req = static_cast<const struct amdxdna_ccmd_read_sysfs_req *>(hdr);
-    vxdna_ccmd_error_wrap(ctx, [&]() {
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
         ctx->read_sysfs(req);
     });
 }
@@ -1811,11 +2017,23 @@ vxdna_ccmd_sync_bo([[maybe_unused]] vxdna &device, const std::shared_ptr<vxdna_c
                    const void *hdr)
 {
     auto *req = static_cast<const struct amdxdna_ccmd_sync_bo_req *>(hdr);
-    vxdna_ccmd_error_wrap(ctx, [&]() {
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
         ctx->sync_bo(req);
     });
 }
 
+static void
+vxdna_ccmd_sync_bo_async([[maybe_unused]] vxdna &device, const std::shared_ptr<vxdna_context>& ctx,
+                         const void *hdr)
+{
+    auto *req = static_cast<const struct amdxdna_ccmd_sync_bo_async_req *>(hdr);
+
+    // Nobody reads the response, error is reported by next WAIT_CMD.
+    vxdna_ccmd_error_wrap(ctx, req->hdr.rsp_off, [&]() {
+        ctx->sync_bo_async(req);
+    });
+}
+
 // Definition of the CCMD handler type for AMDXDNA
 using amdxdna_ccmd_handler_t = void(*)(vxdna &device,
     const std::shared_ptr<vxdna_context>& ctx,
@@ -1834,7 +2052,7 @@ struct amdxdna_ccmd_dispatch_entry {
 #define AMD_CCMD_DISPATCH_ENTRY(name) \
     { #name, vxdna_ccmd_##name, sizeof(struct amdxdna_ccmd_##name##_req) }
 
-constexpr size_t AMDXDNA_CCMD_COUNT = 12;
+constexpr size_t AMDXDNA_CCMD_COUNT = 14;
 constexpr std::array<amdxdna_ccmd_dispatch_entry, AMDXDNA_CCMD_COUNT> amdxdna_ccmd_dispatch_table = {{
     AMD_CCMD_DISPATCH_ENTRY(nop),
     AMD_CCMD_DISPATCH_ENTRY(init),
@@ -1848,11 +2066,12 @@ constexpr std::array<amdxdna_ccmd_dispatch_entry, AMDXDNA_CCMD_COUNT> amdxdna_cc
     AMD_CCMD_DISPATCH_ENTRY(get_info),
     AMD_CCMD_DISPATCH_ENTRY(read_sysfs),
     AMD_CCMD_DISPATCH_ENTRY(sync_bo),
+    AMD_CCMD_DISPATCH_ENTRY(exec_cmd_async),
+    AMD_CCMD_DISPATCH_ENTRY(sync_bo_async),
 }};
 
-void
-vxdna::
-dispatch_ccmd(std::shared_ptr<vxdna_context> &ctx, const struct vdrm_ccmd_req *hdr)
+static const struct amdxdna_ccmd_dispatch_entry *
+lookup_ccmd(const struct vdrm_ccmd_req *hdr)
 {
     if (!hdr->cmd || hdr->cmd > amdxdna_ccmd_dispatch_table.size())
         VACCEL_THROW_MSG(-EINVAL, "invalid cmd: %u", hdr->cmd);
@@ -1866,6 +2085,21 @@ dispatch_ccmd(std::shared_ptr<vxdna_context> &ctx, const struct vdrm_ccmd_req *h
     if (hdr->len < ccmd->size)
         VACCEL_THROW_MSG(-EINVAL, "request length is smaller than the expected size: %u < %u",
                          hdr->len, ccmd->size);
+    return ccmd;
+}
+
+void
+vxdna::
+check_ccmd(const struct vdrm_ccmd_req *hdr) const
+{
+    (void)lookup_ccmd(hdr);
+}
+
+void
+vxdna::
+dispatch_ccmd(std::shared_ptr<vxdna_context> &ctx, const struct vdrm_ccmd_req *hdr)
+{
+    const struct amdxdna_ccmd_dispatch_entry *ccmd = lookup_ccmd(hdr);
 
     vxdna_dbg("%s: hdr={cmd=%u, len=%u, seqno=%u, rsp_off=0x%x)", ccmd->name, hdr->cmd,
               hdr->len, hdr->seqno, hdr->rsp_off);
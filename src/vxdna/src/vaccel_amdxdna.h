@@ -17,7 +17,10 @@
 #include <stdexcept>
 #include <memory>
 #include <array>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <vector>
 #include <sys/mman.h>
 
 #include "drm_hw.h" // from xdna shim virtio
@@ -140,6 +143,105 @@ private:
     size_t m_host_map_len = 0;
 };
 
+/**
+ * @brief Fence retirement reactor shared by all hw contexts of a context
+ *
+ * One thread waits on the pending (syncobj, point) pairs of every hw
+ * context on the same DRM FD with a single wait-any
+ * DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT. When it wakes up, all signaled or
+ * timed out fences are retired in one pass, so a fence that never
+ * signals does not hold back later fences.
+ *
+ * An internal wakeup syncobj is part of every wait, so new fences and
+ * removed hw contexts are picked up without waiting for the current
+ * wait to finish.
+ *
+ * Syncobj handles are per DRM FD, hence one reactor per context.
+ *
+ * @note Non-copyable and non-movable.
+ */
+class vxdna_fence_reactor {
+public:
+    using write_fence_fn = void (*)(void *cookie, uint32_t ctx_id,
+                                    uint32_t ring_idx, uint64_t fence_id);
+
+    vxdna_fence_reactor() = delete;
+    vxdna_fence_reactor(const vxdna_fence_reactor&) = delete;
+    vxdna_fence_reactor& operator=(const vxdna_fence_reactor&) = delete;
+    vxdna_fence_reactor(vxdna_fence_reactor&&) = delete;
+    vxdna_fence_reactor& operator=(vxdna_fence_reactor&&) = delete;
+
+    /**
+     * @brief Create wakeup syncobj and start the reactor thread
+     *
+     * @param fd DRM file descriptor owning the syncobjs
+     * @param cookie Device cookie passed to @p write_fence
+     * @param ctx_id Context ID passed to @p write_fence
+     * @param write_fence Callback signaling a fence on the guest ring
+     * @throws vaccel_error on syncobj or thread creation failure
+     */
+    vxdna_fence_reactor(int fd, void *cookie, uint32_t ctx_id, write_fence_fn write_fence);
+
+    /**
+     * @brief Destructor - stops the reactor thread, pending fences are dropped
+     */
+    ~vxdna_fence_reactor() noexcept;
+
+    /**
+     * @brief Add a fence to be retired once its sync point signals
+     *
+     * @param fence Fence with syncobj, sync point and absolute timeout
+     * @throws vaccel_error -ENOSPC when too many fences are pending
+     */
+    void add(std::shared_ptr<vaccel_fence> fence);
+
+    /**
+     * @brief Drop all pending fences of a hw context
+     *
+     * Returns once the reactor no longer waits on the hw context syncobj,
+     * so that the caller can destroy it.
+     *
+     * @param ring_idx Ring index of the hw context
+     */
+    void remove(uint32_t ring_idx);
+
+private:
+    /**
+     * Ceiling for the @m_pending vector, shared by all hw contexts.
+     *
+     * A guest can submit fences with sync points that are never produced
+     * (guest-controlled timeline value with WAIT_FOR_SUBMIT). Cap the queue
+     * so a misbehaving guest can't drive the host heap unbounded; legitimate
+     * workloads stay far below this depth because in-flight fence counts
+     * track NPU command parallelism.
+     */
+    static constexpr size_t MAX_PENDING_FENCES = 1024;
+
+    /**
+     * @brief Reactor thread main loop
+     */
+    void run();
+
+    /**
+     * @brief Wake up reactor thread from its current wait
+     */
+    void kick();
+
+    int m_fd;                                   /**< DRM file descriptor */
+    void *m_cookie;                             /**< Device cookie */
+    uint32_t m_ctx_id;                          /**< Context ID */
+    write_fence_fn m_write_fence;               /**< Fence callback */
+
+    std::mutex m_lock;                          /**< Protects state below */
+    std::condition_variable m_cv;               /**< Signals wait set rebuilt */
+    std::vector<std::shared_ptr<vaccel_fence>> m_pending; /**< Pending fences */
+    uint64_t m_wake_point = 0;                  /**< Last wakeup point signaled */
+    uint64_t m_generation = 0;                  /**< Bumped on every remove() */
+    uint64_t m_seen_generation = 0;             /**< Generation of current wait set */
+    bool m_stop = false;                        /**< Stop signal for thread */
+    uint32_t m_wake_syncobj = 0;                /**< Wakeup syncobj handle */
+    std::thread m_thread;                       /**< Reactor thread */
+};
 
 // Forward declaration
 class vxdna;
@@ -191,6 +293,10 @@ public:
      */
     ~vxdna_context() {
         vxdna_dbg("Context destroying: ctx_id=%u, fd=%d", get_id(), get_fd());
+        // Hw contexts and their fence reactor use the FD, release them first.
+        for (auto &hwctx : m_hwctx_slots)
+            hwctx.reset();
+        m_fence_reactor.reset();
         m_bo_table.clear();
         release_heap_arena();
         close(get_fd());
@@ -267,8 +373,9 @@ public:
     /**
      * @brief Write error response to response buffer
      * @param err Error code (negative errno)
+     * @param rsp_off Offset within response buffer
      */
-    void write_err_rsp(int err);
+    void write_err_rsp(int err, uint32_t rsp_off = 0);
 
     /**
      * @brief Write response data to response buffer
@@ -289,7 +396,7 @@ public:
      * @brief Create a hardware execution context
      *
      * Creates an NPU hardware context with specified QoS parameters.
-     * Starts a polling thread for async fence completion.
+     * Starts the context fence reactor with the first hw context.
      *
      * @param req HW context creation request
      * @throws vaccel_error on creation failure
@@ -326,6 +433,17 @@ public:
      */
     void exec_cmd(const struct amdxdna_ccmd_exec_cmd_req *req);
 
+    /**
+     * @brief Execute a command without a response
+     *
+     * Sequence number is assigned by guest and verified here. A failure
+     * is reported by the next wait_cmd() on the hardware context.
+     *
+     * @param req Execution request with command handles
+     * @throws vaccel_error on submission failure
+     */
+    void exec_cmd_async(const struct amdxdna_ccmd_exec_cmd_async_req *req);
+
     /**
      * @brief Wait for command completion with timeout
      *
@@ -374,6 +492,17 @@ public:
      */
     void sync_bo(const struct amdxdna_ccmd_sync_bo_req *req);
 
+    /**
+     * @brief Sync a BO without a response
+     *
+     * A failure is kept and reported by every later wait_cmd() on this
+     * context.
+     *
+     * @param req Sync request (BO handle, direction, offset, size)
+     * @throws vaccel_error if the BO isn't owned by this ctx or the ioctl fails
+     */
+    void sync_bo_async(const struct amdxdna_ccmd_sync_bo_async_req *req);
+
     /** @} */
 
     /**
@@ -403,23 +532,23 @@ private:
      * @brief Hardware execution context for NPU command submission
      *
      * Manages a single NPU hardware context with its associated DRM handles,
-     * fence timeline, and async completion polling thread.
+     * fence timeline, and async completion through the context fence reactor.
      *
      * Architecture:
      * - Each hwctx has a unique DRM hardware context handle
      * - Uses DRM syncobj for timeline-based fence tracking
-     * - Runs a dedicated polling thread to wait on pending fences
+     * - Hands pending fences to the context's vxdna_fence_reactor
      * - Signals completion via write_context_fence callback
      *
      * Fence flow:
      * 1. exec_cmd() returns sequence number
      * 2. wait_cmd() sets sync_point and timeout via set_sync_point()
      * 3. submit_fence() creates vaccel_fence and adds to pending queue
-     * 4. Polling thread waits on syncobj timeline
+     * 4. Reactor waits on syncobj timeline along with other hw contexts
      * 5. On completion, invokes write_fence_callback to notify guest
      *
      * @note Non-copyable and non-movable.
-     * @note Destructor joins polling thread before cleanup.
+     * @note Destructor removes its fences from the reactor before cleanup.
      */
     class vxdna_hwctx {
     public:
@@ -432,18 +561,19 @@ private:
         /**
          * @brief Construct hardware context
          *
-         * Creates DRM hardware context via DRM_IOCTL_AMDXDNA_CREATE_HWCTX
-         * and starts the fence polling thread.
+         * Creates DRM hardware context via DRM_IOCTL_AMDXDNA_CREATE_HWCTX.
          *
          * @param ctx Parent context (provides cookie, callbacks, FD)
          * @param req Creation request with QoS parameters
+         * @param reactor Reactor retiring fences of this hw context
          * @throws vaccel_error on DRM ioctl failure
          */
         vxdna_hwctx(const vxdna_context &ctx,
-                    const struct amdxdna_ccmd_create_ctx_req *req);
+                    const struct amdxdna_ccmd_create_ctx_req *req,
+                    vxdna_fence_reactor &reactor);
 
         /**
-         * @brief Destructor - stops polling thread and destroys DRM handles
+         * @brief Destructor - removes pending fences and destroys DRM handles
          */
         ~vxdna_hwctx() noexcept;
 
@@ -463,6 +593,26 @@ private:
          */
         uint64_t exec_cmd(const struct amdxdna_ccmd_exec_cmd_req *req);
 
+        /**
+         * @brief Execute command with sequence number assigned by guest
+         *
+         * On failure or sequence number mismatch, the hardware context
+         * is marked failed and later async executions are dropped.
+         *
+         * @param req Execution request, hdr.seqno has expected sequence number
+         * @throws vaccel_error on failure
+         */
+        void exec_cmd_async(const struct amdxdna_ccmd_exec_cmd_async_req *req);
+
+        /**
+         * @brief Get error of failed async execution
+         * @return 0 if no async execution has failed, negative errno otherwise
+         */
+        int get_async_error() const noexcept
+        {
+            return m_async_error;
+        }
+
         /**
          * @brief Set sync point for next fence submission
          *
@@ -500,33 +650,8 @@ private:
         void submit_fence(uint64_t fence_id);
 
     private:
-        /**
-         * Per-hwctx ceiling for the @m_pending_fences vector.
-         *
-         * The polling thread drains fences one at a time via a blocking
-         * DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT, so a single fence whose
-         * sync point will never be produced (guest-controlled timeline
-         * value with @flags = WAIT_FOR_SUBMIT) parks the polling thread
-         * indefinitely and lets the queue grow with every subsequent
-         * submit_fence on this hwctx.  Cap the queue so a misbehaving
-         * guest can't drive the host heap unbounded; legitimate
-         * workloads stay far below this depth because in-flight fence
-         * counts track NPU command parallelism (tens at most).
-         */
-        static constexpr size_t MAX_PENDING_FENCES = 1024;
-
-        /**
-         * @brief Poll and retire pending fences
-         *
-         * Waits on DRM syncobj timeline for each pending fence.
-         * Invokes callback when fence signals or times out.
-         *
-         * @param copy_pending_fences Fences to process (moved from queue)
-         */
-        void poll_and_retire_pending(std::vector<std::shared_ptr<vaccel_fence>> &&copy_pending_fences);
-
         /** @name Context Information
-         * Copied from parent context for use in async polling thread.
+         * Copied from parent context for immediate fence callback.
          * @{
          */
         void *m_cookie = nullptr;                   /**< Device cookie */
@@ -543,10 +668,8 @@ private:
         uint64_t m_sync_point = 0;                  /**< Current sync point */
         int64_t m_timeout_nsec = 0;                 /**< Timeout for current sync */
         bool m_has_sync_point = false;              /**< Whether sync point is set */
-        std::condition_variable m_cv;               /**< Wakes polling thread */
-        std::vector<std::shared_ptr<vaccel_fence>> m_pending_fences; /**< Queue */
-        std::thread m_polling_thread;               /**< Async polling thread */
-        std::atomic<bool> m_stop_polling{false};    /**< Stop signal for thread */
+        vxdna_fence_reactor &m_reactor;             /**< Retires pending fences */
+        std::atomic<int> m_async_error{0};          /**< First async exec error */
         /** @} */
 
         /** @name DRM Handles
@@ -575,9 +698,23 @@ private:
      */
     std::shared_ptr<vxdna_hwctx> find_hwctx_by_handle(uint32_t ctx_handle) const;
 
+    /**
+     * @brief Sync a BO of this context through the driver
+     * @throws vaccel_error if the BO isn't owned by this ctx or the ioctl fails
+     */
+    void sync_bo(uint32_t handle, uint32_t direction, uint64_t offset, uint64_t size);
+
+    /**
+     * @brief Get the fence reactor, starting it on first use
+     * @return Reactor shared by all hw contexts of this context
+     * @throws vaccel_error if the reactor cannot be started
+     */
+    vxdna_fence_reactor &get_fence_reactor();
+
     // Context-owned resources (cookie/callbacks accessed via base_type::get_device())
     std::shared_ptr<vaccel_resource> m_resp_res;
     vaccel_map<uint32_t, std::shared_ptr<vxdna_bo>> m_bo_table;
+    std::atomic<int> m_async_error{0};          /**< First async sync_bo error not yet reported */
 
     /*
      * Hw contexts indexed directly by their virtio ring index (hwctx_ring_idx()
@@ -587,6 +724,7 @@ private:
      * unused (reserved platform ring / AMDXDNA_INVALID_CTX_HANDLE).
      */
     mutable std::mutex m_hwctx_lock;
+    std::unique_ptr<vxdna_fence_reactor> m_fence_reactor;
     std::array<std::shared_ptr<vxdna_hwctx>, MAX_HWCTX_PER_CTX + 1> m_hwctx_slots;
 
     /** Cumulative DEV_HEAP size committed on this context (bytes). */
@@ -766,6 +904,17 @@ public:
      */
     void dispatch_ccmd(std::shared_ptr<vxdna_context> &ctx, const struct vdrm_ccmd_req *hdr);
 
+    /**
+     * @brief Validate a single ccmd without dispatching it
+     *
+     * Used to check every record of a command stream before any of them
+     * is executed, so that a malformed stream is rejected as a whole.
+     *
+     * @param hdr Command header with type and length
+     * @throws vaccel_error on invalid command
+     */
+    void check_ccmd(const struct vdrm_ccmd_req *hdr) const;
+
     /** @} */
 
 private:
@@ -773,7 +922,7 @@ private:
      * @brief Static capability set for AMDXDNA devices
      */
     inline static constexpr struct vaccel_drm_capset capset = {
-        .wire_format_version = 1,   /**< Protocol wire format version */
+        .wire_format_version = AMDXDNA_WIRE_FORMAT_ASYNC_SYNC_BO, /**< Protocol wire format version */
         .version_major = 1,         /**< Major version */
         .version_minor = 0,         /**< Minor version */
         .version_patchlevel = 0,    /**< Patch level */
@@ -838,22 +987,23 @@ int vxdna_device_process_ccmd(void *cookie, const void *cmd_buf, size_t buf_size
  * @tparam ContextType Context type (must have write_err_rsp method)
  * @tparam F Callable type (lambda, function, etc.)
  * @param ctx Context to write error response to
+ * @param rsp_off Offset within response buffer requested by guest
  * @param f Handler function to execute
  */
 template<typename ContextType, typename F> void
-vxdna_ccmd_error_wrap(const std::shared_ptr<ContextType> &ctx, F &&f)
+vxdna_ccmd_error_wrap(const std::shared_ptr<ContextType> &ctx, uint32_t rsp_off, F &&f)
 {
     try {
         f();
     } catch (const vaccel_error& e) {
         vxdna_err("ccmd failed: %s", e.what());
-        ctx->write_err_rsp(e.code());
+        ctx->write_err_rsp(e.code(), rsp_off);
     } catch (const std::exception& e) {
         vxdna_err("ccmd failed (unexpected): %s", e.what());
-        ctx->write_err_rsp(-EIO);
+        ctx->write_err_rsp(-EIO, rsp_off);
     } catch (...) {
         vxdna_err("ccmd failed (unknown exception)");
-        ctx->write_err_rsp(-EIO);
+        ctx->write_err_rsp(-EIO, rsp_off);
     }
 }
 
@@ -556,8 +556,8 @@ protected:
  *
  * Lifecycle:
  * 1. Created when submit_fence is called with pending sync point
- * 2. Added to hardware context's pending fence queue
- * 3. Polling thread waits on syncobj timeline
+ * 2. Added to the context fence reactor's pending queue
+ * 3. Reactor thread waits on syncobj timelines of all hw contexts
  * 4. On signal/timeout, callback invoked with fence ID
  *
  * @note Immutable after construction.
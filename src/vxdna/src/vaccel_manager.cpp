@@ -249,26 +249,47 @@ _vaccel_submit_ccmd(void *cookie, uint32_t ctx_id, const void *ccmd, uint32_t cc
 
     vxdna_dbg("Submitting command buffer: ctx_id=%u, size=%u", ctx->get_id(), ccmd_size);
 
-    while (ccmd_size >= sizeof(struct vdrm_ccmd_req)) {
-        const struct vdrm_ccmd_req *hdr = reinterpret_cast<const struct vdrm_ccmd_req *>(buf);
+    /* A guest may batch many ccmds into one stream. Validate every record
+     * before dispatching any of them, so that a truncated or malformed
+     * stream is rejected as a whole instead of being partially executed.
+     */
+    uint32_t remaining = ccmd_size;
+    uint32_t nr_records = 0;
+    const uint8_t *p = buf;
+    while (remaining >= sizeof(struct vdrm_ccmd_req)) {
+        const struct vdrm_ccmd_req *hdr = reinterpret_cast<const struct vdrm_ccmd_req *>(p);
 
         /* Sanity check first: */
-        if ((hdr->len > ccmd_size) || (hdr->len < sizeof(*hdr)) || (hdr->len & (alignment - 1)))
+        if ((hdr->len > remaining) || (hdr->len < sizeof(*hdr)) || (hdr->len & (alignment - 1)))
             VACCEL_THROW_MSG(-EINVAL, "bad size, %u vs %u (cmd %u, min alignment %u)",
-                             hdr->len, ccmd_size, hdr->cmd, alignment);
+                             hdr->len, remaining, hdr->cmd, alignment);
 
         if (hdr->rsp_off & (alignment - 1))
             VACCEL_THROW_MSG(-EINVAL, "bad rsp_off, %u, min alignment %u",
                             hdr->rsp_off, alignment);
 
-        device->dispatch_ccmd(ctx, hdr);
+        device->check_ccmd(hdr);
 
-        buf += hdr->len;
-        ccmd_size -= hdr->len;
+        p += hdr->len;
+        remaining -= hdr->len;
+        nr_records++;
     }
 
-    if (ccmd_size > 0)
-        VACCEL_THROW_MSG(-EINVAL, "bad size, %u trailing bytes", ccmd_size);
+    if (remaining > 0)
+        VACCEL_THROW_MSG(-EINVAL, "bad size, %u trailing bytes", remaining);
+
+    if (nr_records > 1)
+        vxdna_dbg("Dispatching %u batched commands: ctx_id=%u", nr_records, ctx->get_id());
+
+    /* Errors of individual commands are reported through their own
+     * response slots, the rest of the stream is still dispatched.
+     */
+    while (nr_records--) {
+        const struct vdrm_ccmd_req *hdr = reinterpret_cast<const struct vdrm_ccmd_req *>(buf);
+
+        device->dispatch_ccmd(ctx, hdr);
+        buf += hdr->len;
+    }
 }
 
 static void
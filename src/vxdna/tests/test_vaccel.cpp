@@ -15,6 +15,9 @@
 
 #include <gtest/gtest.h>
 #include <errno.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
 #include <cstring>
 #include <thread>
 #include <vector>
@@ -1262,6 +1265,301 @@ TEST_F(VaccelRendererTest, SubmitCcmdReadSysfsInvalidNode) {
     EXPECT_LT(ret, 0) << "Should fail with non-existent sysfs node";
 }
 
+TEST_F(VaccelRendererTest, SubmitCcmdErrorResponseAtRspOffset) {
+    if (drm_fd_ < 0) {
+        GTEST_SKIP() << "No DRM device available";
+    }
+
+    // Create device and context
+    int ret = createTestDevice(VIRACCEL_CAPSET_ID_AMDXDNA);
+    ASSERT_EQ(ret, 0);
+
+    uint32_t ctx_id = 1;
+    ret = vaccel_create_ctx_with_flags(cookie_, ctx_id, 0, 0, nullptr);
+    ASSERT_EQ(ret, 0);
+
+    // Create response resource with room for more than one response
+    std::vector<uint8_t> resp_buf(4096 * 2);
+    struct iovec resp_iov = {
+        .iov_base = resp_buf.data(),
+        .iov_len = resp_buf.size()
+    };
+
+    struct vaccel_create_resource_blob_args resp_res_args = {};
+    resp_res_args.res_handle = 100;
+    resp_res_args.size = resp_buf.size();
+    resp_res_args.blob_mem = VIRTGPU_BLOB_MEM_GUEST;
+    resp_res_args.iovecs = &resp_iov;
+    resp_res_args.num_iovs = 1;
+    resp_res_args.ctx_id = ctx_id;
+
+    ret = vaccel_create_resource_blob(cookie_, &resp_res_args);
+    ASSERT_EQ(ret, 0);
+
+    // Send INIT command
+    struct amdxdna_ccmd_init_req init_cmd = {};
+    init_cmd.hdr.cmd = AMDXDNA_CCMD_INIT;
+    init_cmd.hdr.len = sizeof(init_cmd);
+    init_cmd.rsp_res_id = 100;
+
+    ret = vaccel_submit_ccmd(cookie_, ctx_id, &init_cmd, sizeof(init_cmd));
+    EXPECT_EQ(ret, 0);
+
+    // Failing READ_SYSFS with response expected in the second page
+    const uint32_t rsp_off = 4096;
+    alignas(struct amdxdna_ccmd_read_sysfs_req) char cmd_buf[128];
+    auto *read_sysfs_cmd = reinterpret_cast<struct amdxdna_ccmd_read_sysfs_req*>(cmd_buf);
+    read_sysfs_cmd->hdr.cmd = AMDXDNA_CCMD_READ_SYSFS;
+    const char *node_name = "nonexistent_node_12345";
+    read_sysfs_cmd->hdr.len = sizeof(struct amdxdna_ccmd_read_sysfs_req) + strlen(node_name) + 1;
+    read_sysfs_cmd->hdr.rsp_off = rsp_off;
+    strcpy(read_sysfs_cmd->node_name, node_name);
+
+    (void)vaccel_submit_ccmd(cookie_, ctx_id, read_sysfs_cmd, read_sysfs_cmd->hdr.len);
+
+    // Error is reported where guest asked for it, not at offset 0
+    auto *rsp = reinterpret_cast<struct amdxdna_ccmd_rsp*>(resp_buf.data() + rsp_off);
+    EXPECT_NE(rsp->ret, 0) << "Error response should be written at rsp_off";
+    auto *rsp0 = reinterpret_cast<struct amdxdna_ccmd_rsp*>(resp_buf.data());
+    EXPECT_EQ(rsp0->base.len, 0u) << "Nothing should be written at offset 0";
+}
+
+TEST_F(VaccelRendererTest, SubmitCcmdExecCmdAsyncNoHwctx) {
+    if (drm_fd_ < 0) {
+        GTEST_SKIP() << "No DRM device available";
+    }
+
+    // Create device and context
+    int ret = createTestDevice(VIRACCEL_CAPSET_ID_AMDXDNA);
+    ASSERT_EQ(ret, 0);
+
+    uint32_t ctx_id = 1;
+    ret = vaccel_create_ctx_with_flags(cookie_, ctx_id, 0, 0, nullptr);
+    ASSERT_EQ(ret, 0);
+
+    // Create response resource
+    std::vector<uint8_t> resp_buf(4096);
+    struct iovec resp_iov = {
+        .iov_base = resp_buf.data(),
+        .iov_len = resp_buf.size()
+    };
+
+    struct vaccel_create_resource_blob_args resp_res_args = {};
+    resp_res_args.res_handle = 100;
+    resp_res_args.size = resp_buf.size();
+    resp_res_args.blob_mem = VIRTGPU_BLOB_MEM_GUEST;
+    resp_res_args.iovecs = &resp_iov;
+    resp_res_args.num_iovs = 1;
+    resp_res_args.ctx_id = ctx_id;
+
+    ret = vaccel_create_resource_blob(cookie_, &resp_res_args);
+    ASSERT_EQ(ret, 0);
+
+    // Send INIT command
+    struct amdxdna_ccmd_init_req init_cmd = {};
+    init_cmd.hdr.cmd = AMDXDNA_CCMD_INIT;
+    init_cmd.hdr.len = sizeof(init_cmd);
+    init_cmd.rsp_res_id = 100;
+
+    ret = vaccel_submit_ccmd(cookie_, ctx_id, &init_cmd, sizeof(init_cmd));
+    EXPECT_EQ(ret, 0);
+
+    // Async exec on a hw context which does not exist
+    alignas(struct amdxdna_ccmd_exec_cmd_async_req) uint8_t cmd_buf[
+        sizeof(struct amdxdna_ccmd_exec_cmd_async_req) + sizeof(uint64_t)] = {};
+    auto *exec_cmd = reinterpret_cast<struct amdxdna_ccmd_exec_cmd_async_req*>(cmd_buf);
+    exec_cmd->hdr.cmd = AMDXDNA_CCMD_EXEC_CMD_ASYNC;
+    exec_cmd->hdr.len = sizeof(cmd_buf);
+    exec_cmd->hdr.seqno = 0;
+    exec_cmd->ctx_handle = 12345;
+    exec_cmd->type = 0;
+    exec_cmd->cmd_count = 1;
+    exec_cmd->cmds_n_args[0] = 1;
+
+    (void)vaccel_submit_ccmd(cookie_, ctx_id, exec_cmd, exec_cmd->hdr.len);
+
+    // Error lands in response buffer even though guest does not wait for it
+    auto *rsp = reinterpret_cast<struct amdxdna_ccmd_rsp*>(resp_buf.data());
+    EXPECT_EQ(rsp->ret, -EINVAL) << "Async exec on unknown hwctx should fail";
+}
+
+TEST_F(VaccelRendererTest, SubmitCcmdBatchedStream) {
+    if (drm_fd_ < 0) {
+        GTEST_SKIP() << "No DRM device available";
+    }
+
+    // Create device and context
+    int ret = createTestDevice(VIRACCEL_CAPSET_ID_AMDXDNA);
+    ASSERT_EQ(ret, 0);
+
+    uint32_t ctx_id = 1;
+    ret = vaccel_create_ctx_with_flags(cookie_, ctx_id, 0, 0, nullptr);
+    ASSERT_EQ(ret, 0);
+
+    // Create response resource
+    std::vector<uint8_t> resp_buf(4096);
+    struct iovec resp_iov = {
+        .iov_base = resp_buf.data(),
+        .iov_len = resp_buf.size()
+    };
+
+    struct vaccel_create_resource_blob_args resp_res_args = {};
+    resp_res_args.res_handle = 100;
+    resp_res_args.size = resp_buf.size();
+    resp_res_args.blob_mem = VIRTGPU_BLOB_MEM_GUEST;
+    resp_res_args.iovecs = &resp_iov;
+    resp_res_args.num_iovs = 1;
+    resp_res_args.ctx_id = ctx_id;
+
+    ret = vaccel_create_resource_blob(cookie_, &resp_res_args);
+    ASSERT_EQ(ret, 0);
+
+    // Send INIT command
+    struct amdxdna_ccmd_init_req init_cmd = {};
+    init_cmd.hdr.cmd = AMDXDNA_CCMD_INIT;
+    init_cmd.hdr.len = sizeof(init_cmd);
+    init_cmd.rsp_res_id = 100;
+
+    ret = vaccel_submit_ccmd(cookie_, ctx_id, &init_cmd, sizeof(init_cmd));
+    EXPECT_EQ(ret, 0);
+
+    // Two async execs on unknown hw context, each with its own response slot
+    constexpr size_t rec_sz = sizeof(struct amdxdna_ccmd_exec_cmd_async_req) + sizeof(uint64_t);
+    alignas(struct amdxdna_ccmd_exec_cmd_async_req) uint8_t cmd_buf[rec_sz * 2] = {};
+    for (int i = 0; i < 2; i++) {
+        auto *exec_cmd = reinterpret_cast<struct amdxdna_ccmd_exec_cmd_async_req*>(cmd_buf + rec_sz * i);
+        exec_cmd->hdr.cmd = AMDXDNA_CCMD_EXEC_CMD_ASYNC;
+        exec_cmd->hdr.len = rec_sz;
+        exec_cmd->hdr.rsp_off = 64 * i;
+        exec_cmd->ctx_handle = 12345;
+        exec_cmd->cmd_count = 1;
+        exec_cmd->cmds_n_args[0] = 1;
+    }
+
+    ret = vaccel_submit_ccmd(cookie_, ctx_id, cmd_buf, sizeof(cmd_buf));
+    EXPECT_EQ(ret, 0) << "Per-command errors should not fail the whole stream";
+
+    // Failure of the first record does not stop the second one
+    auto *rsp0 = reinterpret_cast<struct amdxdna_ccmd_rsp*>(resp_buf.data());
+    auto *rsp1 = reinterpret_cast<struct amdxdna_ccmd_rsp*>(resp_buf.data() + 64);
+    EXPECT_EQ(rsp0->ret, -EINVAL);
+    EXPECT_EQ(rsp1->ret, -EINVAL);
+
+    // Malformed second record, the first one must not be dispatched
+    std::memset(resp_buf.data(), 0, resp_buf.size());
+    auto *bad = reinterpret_cast<struct vdrm_ccmd_req*>(cmd_buf + rec_sz);
+    bad->cmd = 999;
+
+    ret = vaccel_submit_ccmd(cookie_, ctx_id, cmd_buf, sizeof(cmd_buf));
+    EXPECT_LT(ret, 0) << "Stream with invalid record should be rejected";
+    EXPECT_EQ(rsp0->ret, 0) << "No record of a rejected stream should be executed";
+}
+
+static std::atomic<uint64_t> reactor_fences_written{0};
+
+static void reactorWriteFenceCallback(void *, uint32_t, uint32_t, uint64_t) {
+    reactor_fences_written++;
+}
+
+static int64_t monotonicNowNsec() {
+    struct timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+TEST_F(VaccelRendererTest, FenceReactorRetireAndDestroyHwctx) {
+    if (drm_fd_ < 0) {
+        GTEST_SKIP() << "No DRM device available";
+    }
+
+    reactor_fences_written = 0;
+    callbacks_.write_context_fence = reactorWriteFenceCallback;
+
+    // Create device and context
+    int ret = createTestDevice(VIRACCEL_CAPSET_ID_AMDXDNA);
+    ASSERT_EQ(ret, 0);
+
+    uint32_t ctx_id = 1;
+    ret = vaccel_create_ctx_with_flags(cookie_, ctx_id, 0, 0, nullptr);
+    ASSERT_EQ(ret, 0);
+
+    // Create response resource
+    std::vector<uint8_t> resp_buf(4096);
+    struct iovec resp_iov = {
+        .iov_base = resp_buf.data(),
+        .iov_len = resp_buf.size()
+    };
+
+    struct vaccel_create_resource_blob_args resp_res_args = {};
+    resp_res_args.res_handle = 100;
+    resp_res_args.size = resp_buf.size();
+    resp_res_args.blob_mem = VIRTGPU_BLOB_MEM_GUEST;
+    resp_res_args.iovecs = &resp_iov;
+    resp_res_args.num_iovs = 1;
+    resp_res_args.ctx_id = ctx_id;
+
+    ret = vaccel_create_resource_blob(cookie_, &resp_res_args);
+    ASSERT_EQ(ret, 0);
+
+    // Send INIT command
+    struct amdxdna_ccmd_init_req init_cmd = {};
+    init_cmd.hdr.cmd = AMDXDNA_CCMD_INIT;
+    init_cmd.hdr.len = sizeof(init_cmd);
+    init_cmd.rsp_res_id = 100;
+
+    ret = vaccel_submit_ccmd(cookie_, ctx_id, &init_cmd, sizeof(init_cmd));
+    EXPECT_EQ(ret, 0);
+
+    // Hw context needs a real NPU behind the DRM device
+    struct amdxdna_ccmd_create_ctx_req create_cmd = {};
+    create_cmd.hdr.cmd = AMDXDNA_CCMD_CREATE_CTX;
+    create_cmd.hdr.len = sizeof(create_cmd);
+    create_cmd.max_opc = 0x800;
+    create_cmd.num_tiles = 1;
+
+    (void)vaccel_submit_ccmd(cookie_, ctx_id, &create_cmd, sizeof(create_cmd));
+    auto *create_rsp = reinterpret_cast<struct amdxdna_ccmd_create_ctx_rsp*>(resp_buf.data());
+    if (create_rsp->hdr.ret) {
+        GTEST_SKIP() << "No NPU hw context available";
+    }
+    uint32_t handle = create_rsp->handle;
+    uint32_t ring_idx = ((handle - 1) % AMDXDNA_MAX_HWCTX_PER_CTX) + 1;
+
+    // Nothing was submitted, the fence is retired once it times out
+    struct amdxdna_ccmd_wait_cmd_req wait_cmd = {};
+    wait_cmd.hdr.cmd = AMDXDNA_CCMD_WAIT_CMD;
+    wait_cmd.hdr.len = sizeof(wait_cmd);
+    wait_cmd.seq = 1;
+    wait_cmd.timeout_nsec = monotonicNowNsec() + 100000000LL;
+    wait_cmd.ctx_handle = handle;
+
+    ret = vaccel_submit_ccmd(cookie_, ctx_id, &wait_cmd, sizeof(wait_cmd));
+    ASSERT_EQ(ret, 0);
+    ret = vaccel_submit_fence(cookie_, ctx_id, 0, ring_idx, 1);
+    ASSERT_EQ(ret, 0);
+
+    for (int i = 0; i < 500 && reactor_fences_written == 0; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(reactor_fences_written.load(), 1u) << "Timed out fence should be retired";
+
+    // Leave a fence pending, destroying the hw context must not hang on it
+    wait_cmd.timeout_nsec = monotonicNowNsec() + 60 * 1000000000LL;
+    ret = vaccel_submit_ccmd(cookie_, ctx_id, &wait_cmd, sizeof(wait_cmd));
+    ASSERT_EQ(ret, 0);
+    ret = vaccel_submit_fence(cookie_, ctx_id, 0, ring_idx, 2);
+    ASSERT_EQ(ret, 0);
+
+    struct amdxdna_ccmd_destroy_ctx_req destroy_cmd = {};
+    destroy_cmd.hdr.cmd = AMDXDNA_CCMD_DESTROY_CTX;
+    destroy_cmd.hdr.len = sizeof(destroy_cmd);
+    destroy_cmd.handle = handle;
+
+    ret = vaccel_submit_ccmd(cookie_, ctx_id, &destroy_cmd, sizeof(destroy_cmd));
+    EXPECT_EQ(ret, 0);
+
+    vaccel_destroy_ctx(cookie_, ctx_id);
+}
+
 TEST_F(VaccelRendererTest, SubmitCcmdReadSysfsEmptyNodeName) {
     if (drm_fd_ < 0) {
         GTEST_SKIP() << "No DRM device available";
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2026, Advanced Micro Devices, Inc. All rights reserved.
+
+#include "alloc_hook.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Heap allocations made by current thread while counting is on.
+thread_local bool alloc_counting = false;
+thread_local size_t alloc_count = 0;
+
+}
+
+#ifdef SHIM_TEST_ALLOC_HOOK
+
+void *
+operator new(size_t sz)
+{
+  if (alloc_counting)
+    alloc_count++;
+  if (auto p = std::malloc(sz ? sz : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void
+operator delete(void *p, size_t) noexcept
+{
+  std::free(p);
+}
+
+#endif
+
+bool
+alloc_hook_installed()
+{
+#ifdef SHIM_TEST_ALLOC_HOOK
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+alloc_count_start()
+{
+  alloc_count = 0;
+  alloc_counting = true;
+}
+
+size_t
+alloc_count_stop()
+{
+  alloc_counting = false;
+  return alloc_count;
+}
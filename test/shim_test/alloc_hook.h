@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2026, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _SHIMTEST_ALLOC_HOOK_H_
+#define _SHIMTEST_ALLOC_HOOK_H_
+
+#include <cstddef>
+
+// Global operator new is only replaced in shim_alloc_test.elf, so that heap
+// counting never affects tests running in shim_test.elf.
+bool
+alloc_hook_installed();
+
+// Start counting heap allocations made by current thread.
+void
+alloc_count_start();
+
+// Stop counting and return number of allocations since alloc_count_start().
+size_t
+alloc_count_stop();
+
+#endif
@@ -11,7 +11,10 @@
 
 #include "core/common/system.h"
 #include "core/common/shim/fence_handle.h"
+#include "hwq.h"
 #include <algorithm>
+#include <poll.h>
+#include <unistd.h>
 
 namespace {
 
@@ -170,3 +173,30 @@ TEST_cmd_fence_device(device::id_type id, std::shared_ptr<device>& sdev, arg_typ
   test_2proc_cmd_fence_device t2p(id);
   t2p.run_test();
 }
+
+void
+TEST_cmd_fence_sync_file(device::id_type id, std::shared_ptr<device>& sdev, arg_type& arg)
+{
+  auto dev = sdev.get();
+  hw_ctx hwctx{dev};
+  auto hwq = hwctx.get()->get_hw_queue();
+
+  // Signaled fence goes out as sync_file and comes back as a fence.
+  auto fence = dev->create_fence(fence_handle::access_mode::process);
+  fence->signal();
+  auto fd = static_cast<shim_xdna::fence *>(fence.get())->export_sync_file();
+  auto ifence = hwq->import(fd);
+  pollfd pfd = { fd, POLLIN, 0 };
+  auto ret = poll(&pfd, 1, 0);
+  close(fd);
+  if (ret != 1)
+    throw std::runtime_error("Exported sync_file is not signaled");
+  ifence->wait(0);
+
+  // Syncobj shared by fence is still imported as syncobj.
+  auto sfence = dev->create_fence(fence_handle::access_mode::process);
+  auto share = sfence->share();
+  auto jfence = hwq->import(share->get_export_handle());
+  sfence->signal();
+  jfence->wait(0);
+}
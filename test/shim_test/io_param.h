@@ -19,6 +19,8 @@ struct io_test_parameter {
 #define IO_TEST_POLL_WAIT     1
   int wait;
   bool debug;
+  // Submit first round of cmds in one batch.
+  bool batch;
 };
 
 #endif // _SHIMTEST_IO_PARAM_H_
@@ -44,12 +44,13 @@ namespace {
 io_test_parameter io_test_parameters;
 
 void
-io_test_parameter_init(int perf, int type, int wait, bool debug = false)
+io_test_parameter_init(int perf, int type, int wait, bool debug = false, bool batch = false)
 {
   io_test_parameters.perf = perf;
   io_test_parameters.type = type;
   io_test_parameters.wait = wait;
   io_test_parameters.debug = debug;
+  io_test_parameters.batch = batch;
 }
 
 std::unique_ptr<io_test_bo_set_base>
@@ -211,15 +212,22 @@ io_test_cmd_submit_and_wait_thruput(
   int completed = 0;
   size_t wait_idx = 0;
 
+  // First round goes to driver in one batch if asked to.
+  std::vector<buffer_handle *> batch;
   for (size_t i = 0; i < cmdlist_bos.size(); i++) {
     auto cmd_hdl = std::get<0>(cmdlist_bos[i]).get()->get();
     auto cmd_pkt = std::get<1>(cmdlist_bos[i]);
 
     cmd_pkt->state = ERT_CMD_STATE_NEW;
-    hwq->submit_command(cmd_hdl);
+    if (io_test_parameters.batch)
+      batch.push_back(cmd_hdl);
+    else
+      hwq->submit_command(cmd_hdl);
     if (++issued >= total_cmd_submission)
       break;
   }
+  if (!batch.empty())
+    static_cast<shim_xdna::hwq *>(hwq)->submit_commands(batch);
 
   while (completed < issued) {
     io_test_cmd_wait(hwq, std::get<0>(cmdlist_bos[wait_idx]));
@@ -669,6 +677,17 @@ TEST_io_throughput(device::id_type id, std::shared_ptr<device>& sdev, arg_type&
   io_test(id, sdev.get(), total, 8, 1, run_type == IO_TEST_NOOP_RUN ? "nop" : nullptr);
 }
 
+void
+TEST_io_batch_throughput(device::id_type id, std::shared_ptr<device>& sdev, arg_type& arg)
+{
+  unsigned int run_type = static_cast<unsigned int>(arg[0]);
+  unsigned int wait_type = static_cast<unsigned int>(arg[1]);
+  unsigned int total = static_cast<unsigned int>(arg[2]);
+
+  io_test_parameter_init(IO_TEST_THRUPUT_PERF, run_type, wait_type, false, true);
+  io_test(id, sdev.get(), total, 8, 1, run_type == IO_TEST_NOOP_RUN ? "nop" : nullptr);
+}
+
 void
 TEST_io_runlist_latency(device::id_type id, std::shared_ptr<device>& sdev, arg_type& arg)
 {
@@ -12,6 +12,8 @@
 #include "hwctx.h"
 #include "speed.h"
 #include "bo.h"
+#include "buffer.h"
+#include "alloc_hook.h"
 
 #include "core/common/query_requests.h"
 #include "core/common/sysinfo.h"
@@ -75,6 +77,7 @@ void TEST_async_error_multi(device::id_type id, std::shared_ptr<device>& sdev, a
 void TEST_instr_invalid_addr_io(device::id_type id, std::shared_ptr<device>& sdev, arg_type& arg);
 void TEST_io_latency(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_io_throughput(device::id_type, std::shared_ptr<device>&, arg_type&);
+void TEST_io_batch_throughput(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_io_runlist_latency(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_io_runlist_throughput(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_io_runlist_bad_cmd(device::id_type, std::shared_ptr<device>&, arg_type&);
@@ -90,6 +93,7 @@ void TEST_elf_io(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_preempt_elf_io(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_cmd_fence_host(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_cmd_fence_device(device::id_type, std::shared_ptr<device>&, arg_type&);
+void TEST_cmd_fence_sync_file(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_preempt_full_elf_io(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_app_health_query_multi_ctx(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_query_hw_contexts(device::id_type, std::shared_ptr<device>&, arg_type&);
@@ -107,6 +111,7 @@ void TEST_certlog_multi_uc(device::id_type, std::shared_ptr<device>&, arg_type&)
 void TEST_certlog_num_ucs_overflow(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_certlog_invalid_uc_index(device::id_type, std::shared_ptr<device>&, arg_type&);
 void TEST_certlog_payload_overflow(device::id_type, std::shared_ptr<device>&, arg_type&);
+void TEST_io_submit_no_alloc(device::id_type, std::shared_ptr<device>&, arg_type&);
 
 inline void
 set_xrt_path()
@@ -224,6 +229,13 @@ dev_filter_is_aie(device::id_type id, device* dev)
   return dev_filter_is_aie2(id, dev) || dev_filter_is_aie4(id, dev);
 }
 
+// Heap allocation counting only works in shim_alloc_test.elf.
+bool
+dev_filter_is_aie_with_alloc_hook(device::id_type id, device* dev)
+{
+  return alloc_hook_installed() && dev_filter_is_aie(id, dev);
+}
+
 bool
 dev_filter_is_npu1(device::id_type id, device* dev)
 {
@@ -1123,6 +1135,53 @@ TEST_sync_bo_off_size(device::id_type id, std::shared_ptr<device>& sdev, arg_typ
   get_speed_and_print("sync", sync_size, start, end);
 }
 
+void
+TEST_range_set(device::id_type id, std::shared_ptr<device>& sdev, arg_type& arg)
+{
+  using ranges = std::vector<std::pair<size_t, size_t>>;
+  auto check = [] (const ranges& got, const ranges& exp, const char *what) {
+    if (got == exp)
+      return;
+    std::stringstream ss;
+    ss << what << ": got";
+    for (auto& [o, s] : got)
+      ss << " [0x" << std::hex << o << ", +0x" << s << ")";
+    throw std::runtime_error(ss.str());
+  };
+  auto check_true = [] (bool b, const char *what) {
+    if (!b)
+      throw std::runtime_error(what);
+  };
+
+  shim_xdna::range_set rs;
+  check_true(rs.empty(), "new set is not empty");
+  rs.add(0x100, 0);
+  check_true(rs.empty(), "empty range is added");
+
+  // Overlapping and adjacent ranges are merged, others are kept apart.
+  rs.add(0x1000, 0x1000);
+  rs.add(0x1800, 0x1000);
+  rs.add(0x2800, 0x800);
+  rs.add(0x4000, 0x1000);
+  check(rs.intersect(0, 0x10000, false), { {0x1000, 0x2000}, {0x4000, 0x1000} }, "merge");
+
+  check_true(rs.covers(0x1000, 0x2000), "merged range is not covered");
+  check_true(rs.covers(0x2fff, 1), "last byte is not covered");
+  check_true(!rs.covers(0x2fff, 2), "range past end is covered");
+  check_true(!rs.covers(0x2000, 0x3000), "range over a hole is covered");
+  check_true(!rs.covers(0, 0x10), "range before first one is covered");
+
+  // Intersection is clipped to the query, which leaves the set alone.
+  check(rs.intersect(0x2000, 0x2800, false), { {0x2000, 0x1000}, {0x4000, 0x800} }, "intersect");
+  check(rs.intersect(0x3000, 0x1000, false), {}, "intersect hole");
+
+  // Removing punches holes and keeps parts outside of the query.
+  check(rs.intersect(0x1800, 0x3000, true), { {0x1800, 0x1800}, {0x4000, 0x800} }, "remove");
+  check(rs.intersect(0, 0x10000, false), { {0x1000, 0x800}, {0x4800, 0x800} }, "after remove");
+  check(rs.intersect(0, 0x10000, true), { {0x1000, 0x800}, {0x4800, 0x800} }, "remove all");
+  check_true(rs.empty(), "set is not empty after removing all");
+}
+
 void
 TEST_map_read_bo(device::id_type id, std::shared_ptr<device>& sdev, arg_type& arg)
 {
@@ -1841,6 +1900,18 @@ std::vector<test_case> test_list {
   test_case{ "NPU write to read-only user pointer BO is rejected", {},
     TEST_NEGATIVE, dev_filter_is_aie_and_amdxdna_drv, TEST_write_to_readonly_uptr_bo, {}
   },
+  test_case{ "measure no-op kernel submit heap allocations", {},
+    TEST_POSITIVE, dev_filter_is_aie_with_alloc_hook, TEST_io_submit_no_alloc, { NUM_STRESS_IO }
+  },
+  test_case{ "dirty range bookkeeping for sync_bo", {},
+    TEST_POSITIVE, dev_filter_xdna, TEST_range_set, {}
+  },
+  test_case{ "measure throughput of batched no-op kernel submission", {},
+    TEST_POSITIVE, dev_filter_is_aie_or_ve2, TEST_io_batch_throughput, { IO_TEST_NOOP_RUN, IO_TEST_IOCTL_WAIT, NUM_STRESS_IO }
+  },
+  test_case{ "import and export fence as sync_file", {},
+    TEST_POSITIVE, dev_filter_xdna_not_ve2, TEST_cmd_fence_sync_file, {}
+  },
 };
 
 void
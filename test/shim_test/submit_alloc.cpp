@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2026, Advanced Micro Devices, Inc. All rights reserved.
+
+#include "io.h"
+#include "hwctx.h"
+#include "speed.h"
+#include "alloc_hook.h"
+
+#include "core/common/device.h"
+#include <iostream>
+
+using namespace xrt_core;
+using arg_type = const std::vector<uint64_t>;
+
+// Submit no-op command back to back and make sure submit path does not go
+// to heap once it is warmed up.
+void
+TEST_io_submit_no_alloc(device::id_type id, std::shared_ptr<device>& sdev, arg_type& arg)
+{
+  const size_t warmup = 16;
+  const size_t total = static_cast<size_t>(arg[0]);
+  auto dev = sdev.get();
+
+  hw_ctx hwctx{dev, "nop"};
+  auto boset = create_bo_set_for_device(dev, false, "nop");
+  auto hwq = hwctx.get()->get_hw_queue();
+  boset->init_cmd(hwctx, false);
+  boset->sync_before_run();
+  auto cbo = boset->get_bos()[IO_TEST_BO_CMD].tbo.get();
+
+  size_t allocs = 0;
+  clk::duration submit_time{};
+  for (size_t i = 0; i < warmup + total; i++) {
+    boset->reset_cmd_header();
+
+    auto start = clk::now();
+    alloc_count_start();
+    hwq->submit_command(cbo->get());
+    auto n = alloc_count_stop();
+    auto end = clk::now();
+
+    if (i >= warmup) {
+      allocs += n;
+      submit_time += end - start;
+    }
+    hwq->wait_command(cbo->get(), 0);
+  }
+
+  auto ns = std::chrono::duration_cast<ns_t>(submit_time).count();
+  std::cout << "\t" << total << " submits, " << allocs << " heap allocations, "
+            << (ns / total) << " ns per submit" << std::endl;
+  if (allocs)
+    throw std::runtime_error(std::to_string(allocs) + " heap allocations on submit path");
+}